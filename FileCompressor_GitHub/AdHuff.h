@@ -1,12 +1,9 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <map>
-#include <list>
-#include <memory>
 #include <array>
-#include <bitset>
 #include <cstdint>
+#include <cstring>
 #include "FileRW.h"
 #include <optional>
 
@@ -16,156 +13,44 @@ using namespace std;
 
 	class AdaptiveHuffmanCoder
 	{
-		//      
-        //   enable_shared_from_this    shared_ptr
-		struct Node : public std::enable_shared_from_this<Node>
-		{
-			optional<unsigned char> byte; //  (),    ( )
-			int weight;//   =     
-			int number;//    (1-512)
-			shared_ptr<Node> left;//  
-			shared_ptr<Node> right;//  
-			shared_ptr<Node> parent;//  
-			bool isNYT;// ,    NYT (Not Yet Transmitted)
-
-			//      
-
-			//     ( )
-			static shared_ptr<Node> Create()
-			{
-				auto node = make_shared<Node>();
-				node->weight = 0;
-				node->isNYT = false;
-				return node;
-			}
-
-			//     (  )
-			static shared_ptr<Node> Create(shared_ptr<Node> parent)
-			{
-				auto node = make_shared<Node>();
-				node->parent = parent;
-				node->weight = 0;
-				node->isNYT = false;
-				return node;
-			}
-
-			//     
-			static shared_ptr<Node> Create(shared_ptr<Node> parent, unsigned char byte_val)
-			{
-				auto node = make_shared<Node>();
-				node->parent = parent;
-				node->byte = byte_val; //  
-				node->weight = 1; //   = 1
-				node->isNYT = false; //   NYT-
-				return node;
-			}
-
-			/* FindOrDefault
-			*     ( )
-			*  ,    
-			*       nullptr,    
-			*/
-			shared_ptr<Node> FindOrDefault(unsigned char byte)
-			{
-				//    -     
-				if (this->byte.has_value() && this->byte.value() == byte)
-					return shared_from_this();  //     ( enable_shared_from_this)
-
-				//     
-				if (left)
-				{
-					auto result = left->FindOrDefault(byte);
-					if (result != nullptr)
-						return result;
-				}
-
-				//     
-				if (right)
-				{
-					return right->FindOrDefault(byte);
-				}
-
-				return nullptr; //     
-			}
-
-			//      
-			string GetCode(shared_ptr<Node> searched)
-			{
-				return GetCode(searched, "");
-			}
-
-			//    NYT- (    )
-			string GetNYTCode(string code)
-			{
-				if (isNYT)  //    - NYT
-					return code;//   
-
-				//   -  ( NYT)
-				if (left == nullptr && right == nullptr)
-					return "";
-
-				//   NYT    ( '0'  )
-				string result = left->GetNYTCode(code + "0");
-				if (!result.empty())
-					return result;
-
-				//   NYT    ( '1'  )
-				return right->GetNYTCode(code + "1");
-			}
-
-			// ,      
-			bool IsLeftSon(shared_ptr<Node> son)
-			{
-				return left == son;
-			}
-
-			// ,      
-			bool IsRightSon(shared_ptr<Node> son)
-			{
-				return right == son;
-			}
-
-			// ,     ( )
-			bool IsLeaf()
-			{
-				return !left && !right;
-			}
-
-		private:
-			//         
-	        // code -   (     )
-			string GetCode(shared_ptr<Node> searched, string code)
-			{
-				//    -   ( )
-				if (this->byte.has_value() && searched->byte.has_value()
-					&& this->byte == searched->byte)
-					return code; //   
-
-				//   - ,   
-				if (left == nullptr && right == nullptr)
-					return "";
-
-				//      ( '0'  )
-				string result = left->GetCode(searched, code + "0");
-				if (!result.empty())
-					return result;
-
-				//      ( '1'  )
-				return right->GetCode(searched, code + "1");
-			}
-		};
-
-
-	public:
-		shared_ptr<Node> root; //   
-		shared_ptr<Node> NYT;  //    NYT-
-
 		/*
-   *     (513 ):
+   *           :
+   *  -  ,          .
+   *    - 16-  (NONE -  ),  
+   *     ,      .
+   *
+   *     513 :
    * - 256  (      0-255)
    * - 255   (     N   N-1  )
    * - 1  
    * - 1 NYT- (    )
+   *     -    ;     0.
+   */
+		static constexpr int MAX_NODES = 513;
+		static constexpr uint16_t NONE = 0xFFFF; //   ( )
+		static constexpr uint16_t ROOT = 0; //  
+
+		uint16_t parentOf[MAX_NODES]; //  
+		uint16_t leftOf[MAX_NODES];   //  
+		uint16_t rightOf[MAX_NODES];  //  
+		uint16_t numberOf[MAX_NODES]; //   (1-512)
+		uint16_t blockOf[MAX_NODES];  //     ,    
+		uint16_t symbolOf[MAX_NODES]; //  (),    ( )
+		uint32_t weightOf[MAX_NODES]; //   =     
+
+		uint16_t nodeCount; //    
+
+		// ,     ( )
+		bool IsLeaf(uint16_t node) const
+		{
+			return leftOf[node] == NONE && rightOf[node] == NONE;
+		}
+
+	public:
+		uint16_t NYT;  //   NYT-
+
+		/*
+   *    (513 )
    *
    *  :
    * -    512 ()
@@ -173,7 +58,27 @@ using namespace std;
    * -       1  512
    * -         
    */
-		shared_ptr<Node> nodes[513];
+		uint16_t nodes[MAX_NODES];
+
+		/*
+   *     (NONE -    )
+   *   AddToNYT. Replace       ,
+   *    ,    .
+   *      O(1)    .
+   */
+		uint16_t leaves[256];
+
+		/*
+   *   (   FGK/)
+   *     ,      
+   *   - .   -    ,   
+   *      .      ,
+   *       O(1),    -  O().
+   *         ,   .
+   */
+		uint16_t blockLeader[MAX_NODES];  //   
+		uint16_t freeBlocks[MAX_NODES];   //   
+		int freeBlockCount;    //   
 
 		int nextNum; //      
 
@@ -182,24 +87,25 @@ using namespace std;
 		//    (  )
 		void Reset()
 		{
-			//    (   NYT)
-			root = Node::Create();
-			root->number = 512;  //    
-			NYT = root;  //    NYT-
-			nodes[root->number] = root; //    
+			//      (NONE = 0xFFFF),  
+			memset(parentOf, 0xFF, sizeof(parentOf));
+			memset(leftOf, 0xFF, sizeof(leftOf));
+			memset(rightOf, 0xFF, sizeof(rightOf));
+			memset(leaves, 0xFF, sizeof(leaves));
+			memset(weightOf, 0, sizeof(weightOf));
+
+			//   (   NYT)
+			nodeCount = 1;
+			numberOf[ROOT] = 512;  //    
+			NYT = ROOT;  //    NYT-
+			nodes[512] = ROOT; //    
 			nextNum = 511; //     511
-		}
 
-		//      8  ( )
-		string ByteToString(unsigned char byte)
-		{
-			string result = "";
-
-			//    8 ,    (7- )
-			for (int i = 7; i >= 0; i--)
-				result += ((byte >> i) & 1) ? "1" : "0"; //  i- 
-
-			return result;
+			//   ,     0
+			freeBlockCount = MAX_NODES;
+			for (int i = 0; i < MAX_NODES; i++)
+				freeBlocks[i] = static_cast<uint16_t>(MAX_NODES - 1 - i);
+			blockOf[ROOT] = NewBlock(512);
 		}
 
 		/*
@@ -212,41 +118,50 @@ using namespace std;
    */
 		optional<unsigned char> ReadByte(BitReader& reader)
 		{
-			shared_ptr<Node> current = root; //   
+			uint16_t current = ROOT; //   
+
+			//      32 ,      
+			uint64_t bits = reader.PeekBits(32);
+			int used = 0;
 
 			while (true)
 			{
-				if (current->isNYT) //   NYT-
+				if (current == NYT) //   NYT-
+				{
+					reader.Consume(used);
 					return std::nullopt; //  nullopt -  
+				}
 
-				if (current->IsLeaf())  //   
-					return current->byte; //  
-
-				//     
-				bool bit;
-				try
+				if (IsLeaf(current))  //   
 				{
-					bit = reader.ReadBit();
+					reader.Consume(used);
+					return static_cast<unsigned char>(symbolOf[current]); //  
 				}
-				catch (std::exception e)
+
+				//   32  ->   
+				if (used == 32)
 				{
-					//     -  
-					if (std::string(e.what()) == "End of file")
-						break;
+					reader.Consume(used);
+					bits = reader.PeekBits(32);
+					used = 0;
 				}
 
+				//   
+				bool bit = (bits >> (31 - used)) & 1;
+				used++;
+
 				//        
 				if (bit == false)// 0 ->  
 				{
-					if (!current->left)
+					if (leftOf[current] == NONE)
 						throw std::runtime_error("Left child is null");
-					current = current->left;
+					current = leftOf[current];
 				}
 				else// 1 ->  
 				{
-					if (!current->right)
+					if (rightOf[current] == NONE)
 						throw std::runtime_error("Right child is null");
-					current = current->right;
+					current = rightOf[current];
 				}
 			}		
 		}
@@ -278,37 +193,29 @@ using namespace std;
 		    //   
 			while (decodedCount < dataSize)
 			{
-				shared_ptr<Node> node;
-				int count;
+				uint16_t node;
 				optional<unsigned char> byte = ReadByte(reader);
 
 				//  ( NYT)
 				if (!byte.has_value())
 				{
+					//    (8 ) -   
 					unsigned char newSymbol;
-					try
-					{
-						//    (8 ) -   
-						newSymbol = reader.ReadByte();
-					}
-					catch (std::exception e)
-					{
-						if (std::string(e.what()) == "End of file")
-							break;
-					}
+					if (!reader.TryReadByte(newSymbol))
+						break; //  
+
 					//       NYT
 					node = AddToNYT(newSymbol);
 					byte = newSymbol;//    
 				}
 				else // 
 				{
-					//       
-					node = root->FindOrDefault(byte.value());
-					node->weight++; //   
+					//     
+					node = leaves[byte.value()];
 				}
 
-				//     (  )
-				UpdateAll(node->parent);
+				//         (  )
+				UpdateTree(node);
 
 				//      
 				writer.WriteByte(byte.value());
@@ -326,6 +233,9 @@ using namespace std;
 			{
 				reader.ReadBit();
 			}
+
+			//    ,   
+			reader.SyncStream();
 		}
 
 		/*
@@ -348,42 +258,22 @@ using namespace std;
 			streamsize beg = out.tellp();
 
 			//   
+			uint64_t zeroSize = 0;
 			unsigned char zeroByte = 0;
-			out.write(reinterpret_cast<const char*>(&zeroByte), 8); //   
+			out.write(reinterpret_cast<const char*>(&zeroSize), 8); //   
 			out.write(reinterpret_cast<const char*>(&zeroByte), 1); //  
 
 			uint64_t dataSize = 0; //   
 			unsigned char byte;
 
 			//   
-			while (true)
+			//      ,     
+			while (reader.TryReadByte(byte))
 			{
-				try
-				{
-					//      
-					byte = reader.ReadByte();
-					processedBytes.fetch_add(1); //  
-				}
-				catch (exception e)
-				{
-					//     -  
-					if (string(e.what()) == "End of file")
-						break;
-				}
-
-				//     
-				string code = Encode(byte);
-
-				//     
-				for (int i = 0; i < code.length(); i++)
-				{
-					if (code[i] == '1')
-						writer.WriteBit(1);
-					else
-						writer.WriteBit(0);
+				processedBytes.fetch_add(1); //  
 
-					compressedSize++; //   
-				}
+				//      
+				compressedSize += Encode(byte, writer); //   
 				dataSize++; //    
 			}
 
@@ -410,59 +300,121 @@ using namespace std;
 			return (compressedSize + static_cast<uint64_t>(padding)) / 8;
 		}
 
+		//  64-      (    256)
+		static constexpr int CODE_WORDS = 5;
+
+		/*
+   *            
+   *  i ,   ,    i % 64  words[i / 64],
+   *        (  )  .
+   *     
+   */
+		int GetCode(uint16_t node, uint64_t* words)
+		{
+			int length = 0;
+			words[0] = 0;
+
+			while (parentOf[node] != NONE)
+			{
+				uint16_t parent = parentOf[node];
+
+				if (length != 0 && length % 64 == 0)
+					words[length / 64] = 0; //   
+
+				if (rightOf[parent] == node) //   ->  1
+					words[length / 64] |= uint64_t(1) << (length % 64);
+
+				length++;
+				node = parent;
+			}
+
+			return length;
+		}
+
+		//  ,  GetCode:     (  )
+		void WriteCode(const uint64_t* words, int length, BitWriter& writer)
+		{
+			for (int w = (length - 1) / 64; w >= 0; w--)
+			{
+				int count = (w == (length - 1) / 64) ? length - 64 * w : 64;
+				writer.WriteBits(words[w], count);
+			}
+		}
+
 		/*
    *     
    * :
    * 1. ,     
-   * 2.   -       
-   * 3.   -   NYT + 8       
-   * 4.   (  )
+   * 2.   -    
+   * 3.   -   NYT + 8       
+   * 4.       (  )
+   *    
    */
-		string Encode(unsigned char byte)
+		int Encode(unsigned char byte, BitWriter& writer)
 		{
-			shared_ptr<Node> node = root->FindOrDefault(byte); //,      
-			string code = "";
+			uint16_t node = leaves[byte]; //,      
+			uint64_t words[CODE_WORDS];
+			int length = 0;
 
-			if (node) //    
+			if (node != NONE) //    
 			{
-				code = root->GetCode(node); //    
-				node->weight++; //  
+				length = GetCode(node, words); //   
+				if (length <= 64)
+					writer.WriteBits(words[0], length); //   -  
+				else
+					WriteCode(words, length, writer);
 			}
 			else // - 
 			{
-				code = root->GetNYTCode(""); //   NYT-
-				code += ByteToString(byte); //    (8 )
+				length = GetCode(NYT, words); //   NYT-
+				if (length <= 56)
+				{
+					writer.WriteBits((words[0] << 8) | byte, length + 8); //  NYT     
+				}
+				else
+				{
+					WriteCode(words, length, writer);
+					writer.WriteByte(byte);
+				}
+				length += 8;
+
 				node = AddToNYT(byte); //    
 			}
 
-			UpdateAll(node->parent);
+			UpdateTree(node); //     
 
-			return code;
+			return length;
 		}
 
 		/*
    *       NYT-
    * :
-   * 1.          NYT
+   * 1.      ( 0)     NYT
    * 2.   NYT-     NYT
    * 3.   NYT   NYT-
    * 4.  NYT   
    */
-		shared_ptr<Node> AddToNYT(unsigned char byte)
+		uint16_t AddToNYT(unsigned char byte)
 		{
 			//      (   NYT)
-			auto node = Node::Create(NYT, byte);
-			node->number = nextNum; //  
-			NYT->right = node; //   
+			uint16_t node = nodeCount++;
+			parentOf[node] = NYT;
+			symbolOf[node] = byte; //  
+			weightOf[node] = 0; //   = 0,    
+			numberOf[node] = static_cast<uint16_t>(nextNum); //  
+			blockOf[node] = blockOf[NYT]; //  0 -   ,   NYT
+			rightOf[NYT] = node; //   
 			nodes[nextNum--] = node;  //   
+			leaves[byte] = node; //   
 
 			//   NYT- (   NYT)
-			auto _NYT = Node::Create(NYT);
-			_NYT->number = nextNum;  //   
-			_NYT->isNYT = true;   //   NYT
+			uint16_t _NYT = nodeCount++;
+			parentOf[_NYT] = NYT;
+			weightOf[_NYT] = 0;
+			numberOf[_NYT] = static_cast<uint16_t>(nextNum);  //   
+			blockOf[_NYT] = blockOf[NYT];
 
-			NYT->isNYT = false; //  NYT   NYT
-			NYT->left = _NYT;  //   
+			leftOf[NYT] = _NYT;  //   ,  NYT   
 			nodes[nextNum--] = _NYT;  //   
 
 			//     NYT
@@ -471,93 +423,117 @@ using namespace std;
 			return node; //     
 		}
 
-		//         
-		void UpdateAll(shared_ptr<Node> node)
+		//     leader
+		uint16_t NewBlock(int leader)
 		{
-			while (node)
-			{
-				Update(node);  //   
-				node = node->parent; //   
-			}
+			uint16_t block = freeBlocks[--freeBlockCount];
+			blockLeader[block] = static_cast<uint16_t>(leader);
+			return block;
 		}
 
-		//    (     )
-		void Update(shared_ptr<Node> node)
+		/*
+   *   ,     
+   *      w:      (  1 ),
+   *        -  .       w + 1:
+   *       w + 1,      (  ),
+   *        .
+   */
+		void Increment(uint16_t node)
 		{
-			//      ,     (  )
-		    //  :           
-			shared_ptr<Node> toReplace = NodeToReplace(node->number, node->weight);
+			int number = numberOf[node];
+			uint16_t block = blockOf[node];
 
-			//           
-			if (toReplace && node->parent != toReplace)
-				Replace(node, toReplace);  //   
+			if (number - 1 > nextNum && blockOf[nodes[number - 1]] == block)
+				blockLeader[block] = static_cast<uint16_t>(number - 1);
+			else
+				freeBlocks[freeBlockCount++] = block;
 
-			node->weight++; //   
+			weightOf[node]++; //   
+
+			if (number < 512 && weightOf[nodes[number + 1]] == weightOf[node])
+				blockOf[node] = blockOf[nodes[number + 1]];
+			else
+				blockOf[node] = NewBlock(number);
 		}
 
 		/*
-   *      ,    
-   *   =     (   )
-   *  :         
-   *          -  
+   *      ( FGK   )
+   *         :     ,
+   *   .      -  
+   *   NYT ( 0).     ,  
+   *     ,      .
    */
-		shared_ptr<Node> NodeToReplace(int startIndex, int weight)
+		void UpdateTree(uint16_t node)
 		{
-			startIndex++; //      (  )
-			shared_ptr<Node> found = nullptr;
-
-			//     (   )
-			for (int i = startIndex; i < 513; i++)
+			while (node != NONE)
 			{
-				if (nodes[i]->weight == weight)
-					found = nodes[i]; //      
-			}
+				uint16_t leader = nodes[blockLeader[blockOf[node]]];
+				uint16_t parent = parentOf[node];
+
+				if (leader == parent)
+				{
+					Increment(parent);
+					leader = nodes[blockLeader[blockOf[node]]];
+					if (leader != node)
+						Replace(node, leader);
+					Increment(node);
+
+					node = parentOf[parent];
+					continue;
+				}
 
-			return found;
+				if (leader != node)
+					Replace(node, leader);  //   
+				Increment(node);
+
+				node = parentOf[node]; //   
+			}
 		}
 
 		//     ( )
-	    void Replace(shared_ptr<Node> a, shared_ptr<Node> b)
+		void Replace(uint16_t a, uint16_t b)
 		{
 			ReplaceNumbers(a, b); //   
 			ReplaceSons(a, b);  //    
 		}
 
 		//     
-		void ReplaceNumbers(shared_ptr<Node> a, shared_ptr<Node> b)
+		void ReplaceNumbers(uint16_t a, uint16_t b)
 		{
-			//     nodes
-			shared_ptr<Node> temp = nodes[a->number];
-			nodes[a->number] = nodes[b->number];
-			nodes[b->number] = temp;
+			//     nodes
+			uint16_t temp = nodes[numberOf[a]];
+			nodes[numberOf[a]] = nodes[numberOf[b]];
+			nodes[numberOf[b]] = temp;
 
 			//     
-			int tempNum = a->number;
-			a->number = b->number;
-			b->number = tempNum;
+			uint16_t tempNum = numberOf[a];
+			numberOf[a] = numberOf[b];
+			numberOf[b] = tempNum;
 		}
 
 		//     (  )
-		void ReplaceSons(shared_ptr<Node> a, shared_ptr<Node> b)
+		void ReplaceSons(uint16_t a, uint16_t b)
 		{
+			uint16_t aParent = parentOf[a];
+			uint16_t bParent = parentOf[b];
+
 			// ,    b    
-			bool bIsLeftSon = b->parent->IsLeftSon(b);
+			bool bIsLeftSon = leftOf[bParent] == b;
 
 			//  a  b   a
-			if (a->parent->IsLeftSon(a))
-				a->parent->left = b; //  a,  b
+			if (leftOf[aParent] == a)
+				leftOf[aParent] = b; //  a,  b
 			else
-				a->parent->right = b;  //  a,  b
+				rightOf[aParent] = b;  //  a,  b
 
 			//   
-			shared_ptr<Node> temp = b->parent;
-			b->parent = a->parent; // b     a
-			a->parent = temp; // a     b
+			parentOf[b] = aParent; // b     a
+			parentOf[a] = bParent; // a     b
 
 			//  b  a    b
 			if (bIsLeftSon)
-				temp->left = a; //   b  a
+				leftOf[bParent] = a; //   b  a
 			else
-				temp->right = a; //   b  a
+				rightOf[bParent] = a; //   b  a
 		}
 	};
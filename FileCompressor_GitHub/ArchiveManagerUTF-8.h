@@ -12,6 +12,10 @@
 #include "AdHuff.h"
 #include "LZ77.h"
 #include "LZ78.h"
+#include "InterleavedHuffman.h"
+#include "SemiAdaptiveHuffman.h"
+#include "RangeCoder.h"
+#include "LZH.h"
 
 #pragma once
 
@@ -19,7 +23,16 @@ using namespace std;
 
 // Перечисление алгоритмов сжатия
 // Используется uint8_t для экономии памяти при сохранении в файл
-enum class CompressAlg : uint8_t { StaticHuffman = 0, AdaptiveHuffman = 1, LZ77 = 2, LZ78 = 3 };
+enum class CompressAlg : uint8_t { StaticHuffman = 0, AdaptiveHuffman = 1, LZ77 = 2, LZ78 = 3, InterleavedHuffman = 4, SemiAdaptiveHuffman = 5, RangeCoder = 6, LZH = 7 };
+
+// Параметры LZ-алгоритмов (LZ77 и LZH)
+// В архив отдельно не пишутся: каждый кодер сохраняет свои параметры в заголовке файла
+struct LZOptions
+{
+    int windowLog = LZ77::DEFAULT_WINDOW_LOG; // Логарифм размера окна
+    int maxMatch = LZ77::DEFAULT_MAX_MATCH; // Максимальная длина совпадения (у LZH она фиксирована)
+    int level = LZ77::DEFAULT_LEVEL; // Уровень сжатия: 1-3 жадный, 4-6 ленивый, 7-9 оптимальный разбор
+};
 
 // Структура для хранения статистики по сжатию
 struct Statistics
@@ -66,7 +79,7 @@ public:
     double GetDecompressingTime() const { return decompressingTime; }
 
     // Основной метод создания архива (работает в рабочем потоке)
-    void CreateArchive(vector<string> fileNames, string archivepath, CompressAlg alg)
+    void CreateArchive(vector<string> fileNames, string archivepath, CompressAlg alg, LZOptions options = {})
     {
         // Вектор для хранения размеров файлов (чтобы не переоткрывать файлы позже)
         vector<uint64_t> fileSizes;
@@ -161,7 +174,7 @@ public:
 
                 auto start = chrono::steady_clock::now();
 
-                LZ77 lz77;
+                LZ77 lz77{ options.windowLog, options.maxMatch, options.level };
                 stats.sizes[i].second = lz77.EncodeFile(file, archive, processedBytes);
 
                 auto end = chrono::steady_clock::now();
@@ -210,6 +223,82 @@ public:
                 file.close();
             }
             break;
+        case CompressAlg::InterleavedHuffman:
+            for (int i = 0; i < fileNames.size(); i++)
+            {
+                stats.sizes.push_back(make_pair(fileSizes[i], 0));
+
+                ifstream file{ fileNames[i], std::ios::binary };
+
+                auto start = chrono::steady_clock::now();
+
+                InterleavedHuffmanManager ih;
+                stats.sizes[i].second = ih.EncodeFile(file, archive, processedBytes);
+
+                auto end = chrono::steady_clock::now();
+                chrono::duration<double> time = end - start;
+                stats.timeElapsed.push_back(time.count());
+
+                file.close();
+            }
+            break;
+        case CompressAlg::SemiAdaptiveHuffman:
+            for (int i = 0; i < fileNames.size(); i++)
+            {
+                stats.sizes.push_back(make_pair(fileSizes[i], 0));
+
+                ifstream file{ fileNames[i], std::ios::binary };
+
+                auto start = chrono::steady_clock::now();
+
+                SemiAdaptiveHuffmanCoder sah;
+                stats.sizes[i].second = sah.EncodeFile(file, archive, processedBytes);
+
+                auto end = chrono::steady_clock::now();
+                chrono::duration<double> time = end - start;
+                stats.timeElapsed.push_back(time.count());
+
+                file.close();
+            }
+            break;
+        case CompressAlg::RangeCoder:
+            for (int i = 0; i < fileNames.size(); i++)
+            {
+                stats.sizes.push_back(make_pair(fileSizes[i], 0));
+
+                ifstream file{ fileNames[i], std::ios::binary };
+
+                auto start = chrono::steady_clock::now();
+
+                RangeCoder rc;
+                stats.sizes[i].second = rc.EncodeFile(file, archive, processedBytes);
+
+                auto end = chrono::steady_clock::now();
+                chrono::duration<double> time = end - start;
+                stats.timeElapsed.push_back(time.count());
+
+                file.close();
+            }
+            break;
+        case CompressAlg::LZH:
+            for (int i = 0; i < fileNames.size(); i++)
+            {
+                stats.sizes.push_back(make_pair(fileSizes[i], 0));
+
+                ifstream file{ fileNames[i], std::ios::binary };
+
+                auto start = chrono::steady_clock::now();
+
+                LZHCoder lzh{ options.windowLog, options.level };
+                stats.sizes[i].second = lzh.EncodeFile(file, archive, processedBytes);
+
+                auto end = chrono::steady_clock::now();
+                chrono::duration<double> time = end - start;
+                stats.timeElapsed.push_back(time.count());
+
+                file.close();
+            }
+            break;
         }
 
         archive.close();
@@ -290,7 +379,8 @@ public:
         case CompressAlg::LZ77:
             for (uint32_t i = 0; i < fileCount; i++)
             {
-                ofstream file{ unboxTo + fileNames[i], std::ios::binary };
+                // Файл открыт и на чтение: дальние совпадения LZ77 копируются из уже распакованных данных
+                fstream file{ unboxTo + fileNames[i], std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc };
 
                 LZ77 lz77;
 
@@ -341,6 +431,78 @@ public:
                 file.close();
             }
             break;
+        case CompressAlg::InterleavedHuffman:
+            for (uint32_t i = 0; i < fileCount; i++)
+            {
+                ofstream file{ unboxTo + fileNames[i], std::ios::binary };
+
+                InterleavedHuffmanManager ih;
+
+                auto start = chrono::steady_clock::now();
+
+                ih.DecodeFile(archive, file, processedBytes);
+
+                auto end = chrono::steady_clock::now();
+                chrono::duration<double> time = end - start;
+                decompressingTime = time.count();
+
+                file.close();
+            }
+            break;
+        case CompressAlg::SemiAdaptiveHuffman:
+            for (uint32_t i = 0; i < fileCount; i++)
+            {
+                ofstream file{ unboxTo + fileNames[i], std::ios::binary };
+
+                SemiAdaptiveHuffmanCoder sah;
+
+                auto start = chrono::steady_clock::now();
+
+                sah.DecodeFile(archive, file, processedBytes);
+
+                auto end = chrono::steady_clock::now();
+                chrono::duration<double> time = end - start;
+                decompressingTime = time.count();
+
+                file.close();
+            }
+            break;
+        case CompressAlg::RangeCoder:
+            for (uint32_t i = 0; i < fileCount; i++)
+            {
+                ofstream file{ unboxTo + fileNames[i], std::ios::binary };
+
+                RangeCoder rc;
+
+                auto start = chrono::steady_clock::now();
+
+                rc.DecodeFile(archive, file, processedBytes);
+
+                auto end = chrono::steady_clock::now();
+                chrono::duration<double> time = end - start;
+                decompressingTime = time.count();
+
+                file.close();
+            }
+            break;
+        case CompressAlg::LZH:
+            for (uint32_t i = 0; i < fileCount; i++)
+            {
+                ofstream file{ unboxTo + fileNames[i], std::ios::binary };
+
+                LZHCoder lzh;
+
+                auto start = chrono::steady_clock::now();
+
+                lzh.DecodeFile(archive, file, processedBytes);
+
+                auto end = chrono::steady_clock::now();
+                chrono::duration<double> time = end - start;
+                decompressingTime = time.count();
+
+                file.close();
+            }
+            break;
         }
         archive.close();
     }
@@ -353,7 +515,7 @@ public:
     atomic<bool> isWorking{ false };
 
     // Запуск асинхронного создания архива
-    void StartArchiveCreatingAsync(vector<string> fileNames, string archivePath, CompressAlg alg)
+    void StartArchiveCreatingAsync(vector<string> fileNames, string archivePath, CompressAlg alg, LZOptions options = {})
     {
         if (isWorking)// Если уже работает - выходим
             return;
@@ -361,12 +523,12 @@ public:
         isWorking = true;// Устанавливаем флаг работы
 
         // Запускаем рабочий поток с лямбда-функцией
-        workerThread = thread([this, fileNames, archivePath, alg]()
+        workerThread = thread([this, fileNames, archivePath, alg, options]()
             {
                 try
                 {
                     // Выполняем создание архива
-                    CreateArchive(fileNames, archivePath, alg);
+                    CreateArchive(fileNames, archivePath, alg, options);
                 }
                 catch (...)
                 {
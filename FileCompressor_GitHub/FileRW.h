@@ -2,6 +2,7 @@
 #include <vector>
 #include <array>
 #include <bitset>
+#include <cstdint>
 
 using namespace std;
 
@@ -11,64 +12,105 @@ class BitWriter
 private:
     ofstream& out; //âûõîäíîé ïîòîê, êóäà áóäåò ïðîèçâîäèòñÿ çàïèñü
     vector<unsigned char> fileBuffer; // Áóôåð äëÿ ôàéëà
-    unsigned char bitBuffer;               // Áóôåð äëÿ áèòîâ
-    int bitCount;
-    static constexpr size_t BUFFER_SIZE = 4096;
+    size_t bufferPos;                 // Êîëè÷åñòâî çàïîëíåííûõ áàéò â fileBuffer
+    uint64_t bitBuffer;               // Áóôåð äëÿ áèòîâ (64-áèòíûé àêêóìóëÿòîð, áèòû âûðîâíåíû âïðàâî)
+    int bitCount;                     // Êîëè÷åñòâî áèòîâ â àêêóìóëÿòîðå (0-63)
+    static constexpr size_t BUFFER_SIZE = 1 << 16;
     unsigned char paddingBits;
+
+    //ïåðåíîñèò ïîëíîå 64-áèòíîå ñëîâî èç àêêóìóëÿòîðà â ôàéëîâûé áóôåð (ñòàðøèå áàéòû ïåðâûìè)
+    void FlushWord(uint64_t word)
+    {
+        if (bufferPos + 8 > BUFFER_SIZE)
+        {
+            WriteFileBuffer();
+        }
+
+        for (int i = 7; i >= 0; i--)
+        {
+            fileBuffer[bufferPos++] = static_cast<unsigned char>(word >> (i * 8));
+        }
+    }
+
+    //ïèøåò çàïîëíåííóþ ÷àñòü ôàéëîâîãî áóôåðà â ïîòîê
+    void WriteFileBuffer()
+    {
+        out.write(reinterpret_cast<const char*>(fileBuffer.data()), bufferPos);
+        bufferPos = 0;
+    }
 public:
-    BitWriter(std::ofstream& stream) : out(stream), fileBuffer(), bitBuffer(0), bitCount(0), paddingBits(0)
+    BitWriter(std::ofstream& stream) : out(stream), fileBuffer(BUFFER_SIZE), bufferPos(0), bitBuffer(0), bitCount(0), paddingBits(0)
     {
-        fileBuffer.reserve(BUFFER_SIZE);
     }
 
     //ïîëó÷åíèå è ñáðîñ äîïîëíèòåëüíûõ áèòîâ, äîáàâëåííûõ ïîñëå âûçîâà FlushFileBuffer()
     unsigned char GetPaddingBits() { return paddingBits; }
     void ResetPaddingBits() { paddingBits = 0; }
 
-    //ïèøåò îäèí áèò ñíà÷àë â áóôåð
-    void WriteBit(bool bit)
+    //ïèøåò numBits ìëàäøèõ áèòîâ value (0-64), ñòàðøèé áèò ïåðâûì
+    void WriteBits(uint64_t value, int numBits)
     {
-        bitBuffer = (bitBuffer << 1) | (bit ? 1 : 0);
-        bitCount++;
+        if (numBits <= 0)
+            return;
 
-        if (bitCount == 8)
-        {
-            // Äîáàâëÿåì áàéò â ôàéëîâûé áóôåð
-            fileBuffer.push_back(bitBuffer);
-            bitBuffer = 0;
-            bitCount = 0;
+        if (numBits < 64)
+            value &= (uint64_t(1) << numBits) - 1;
 
-            // Åñëè áóôåð çàïîëíåí, çàïèñûâàåì â ôàéë
-            if (fileBuffer.size() >= BUFFER_SIZE)
-            {
-                FlushFileBuffer();
-            }
+        int freeBits = 64 - bitCount;
+        if (numBits < freeBits)
+        {
+            // âñå áèòû ïîìåùàþòñÿ â àêêóìóëÿòîð
+            bitBuffer = (bitBuffer << numBits) | value;
+            bitCount += numBits;
+            return;
         }
+
+        // äîïîëíÿåì àêêóìóëÿòîð äî ïîëíîãî ñëîâà è ñáðàñûâàåì åãî â áóôåð
+        int rest = numBits - freeBits;
+        uint64_t word = (freeBits == 64) ? value : ((bitBuffer << freeBits) | (value >> rest));
+        FlushWord(word);
+
+        bitBuffer = (rest == 0) ? 0 : (value & ((uint64_t(1) << rest) - 1));
+        bitCount = rest;
+    }
+
+    //ïèøåò îäèí áèò ñíà÷àë â áóôåð
+    void WriteBit(bool bit)
+    {
+        WriteBits(bit ? 1 : 0, 1);
     }
 
     //ïèøåò îäèí áàéò â áóôåð
     void WriteByte(unsigned char b)
     {
-        for (int i = 7; i >= 0; i--)
-        {
-            WriteBit((b >> i) & 1);
-        }
+        WriteBits(b, 8);
     }
 
-    //ïèøåò äàííûå áóôåðà â ôàéë
+    //äîïèñûâàåò íåïîëíûé áàéò íóëÿìè è ïèøåò äàííûå áóôåðà â ôàéë
     void FlushFileBuffer()
     {
-        if (!fileBuffer.empty())
+        if (bitCount % 8 != 0)
         {
-            while (bitCount != 0)
-            {
-                WriteBit(0);
-                paddingBits++;
-            }
+            unsigned char padding = 8 - bitCount % 8;
+            bitBuffer <<= padding;
+            bitCount += padding;
+            paddingBits += padding;
+        }
+
+        // ïåðåíîñèì îñòàâøèåñÿ öåëûå áàéòû àêêóìóëÿòîðà â ôàéëîâûé áóôåð
+        if (bufferPos + bitCount / 8 > BUFFER_SIZE)
+        {
+            WriteFileBuffer();
+        }
 
-            out.write(reinterpret_cast<const char*>(fileBuffer.data()), fileBuffer.size());
-            fileBuffer.clear();
+        while (bitCount > 0)
+        {
+            bitCount -= 8;
+            fileBuffer[bufferPos++] = static_cast<unsigned char>(bitBuffer >> bitCount);
         }
+        bitBuffer = 0;
+
+        WriteFileBuffer();
     }
 };
 
@@ -76,26 +118,113 @@ class BitReader
 {
 private:
     ifstream& in;// âõîäíîé ïîòîê, îòêóäà ïðîèçâîäèòñÿ ÷òåíèå äàííûõ
-    unsigned char currentByte;//òåêóùèé ÷èòàåìûé áàéò
-    int bitPos;//êîíêåðåòíûé áèò â òåêóùåì áàéòå
+    vector<unsigned char> fileBuffer; // Áóôåð äëÿ áëî÷íîãî ÷òåíèÿ ôàéëà
+    size_t bufferPos;  // Ïîçèöèÿ ñëåäóþùåãî íåïðî÷èòàííîãî áàéòà â fileBuffer
+    size_t bufferSize; // Êîëè÷åñòâî áàéò, ïðî÷èòàííûõ â fileBuffer
+    uint64_t bitBuffer; // Áèòîâûé áóôåð: ñëåäóþùèé áèò íàõîäèòñÿ â ñòàðøåì ðàçðÿäå
+    int bitCount; // Êîëè÷åñòâî äîñòîâåðíûõ áèòîâ â bitBuffer
+    static constexpr size_t BUFFER_SIZE = 1 << 16;
+
+    //÷èòàåò î÷åðåäíîé áëîê èç ïîòîêà â ôàéëîâûé áóôåð
+    void FillFileBuffer()
+    {
+        in.read(reinterpret_cast<char*>(fileBuffer.data()), BUFFER_SIZE);
+        bufferSize = static_cast<size_t>(in.gcount());
+        bufferPos = 0;
+    }
+
+    //äîçàïîëíÿåò áèòîâûé áóôåð öåëûìè áàéòàìè (íå ìåíåå 57 áèò, åñëè äàííûå åñòü)
+    void Refill()
+    {
+        if (bufferSize - bufferPos >= 8)
+        {
+            // áûñòðûé ïóòü: áåðåì ñðàçó 8 áàéò â big-endian ïîðÿäêå
+            uint64_t word = 0;
+            for (int i = 0; i < 8; i++)
+                word = (word << 8) | fileBuffer[bufferPos + i];
+
+            int bytes = (64 - bitCount) >> 3;
+            bitBuffer |= word >> bitCount;
+            bufferPos += bytes;
+            bitCount += bytes * 8;
+            return;
+        }
+
+        // ìåäëåííûé ïóòü: êîíåö áëîêà, äîáèðàåì ïî îäíîìó áàéòó
+        while (bitCount <= 56)
+        {
+            if (bufferPos == bufferSize)
+            {
+                FillFileBuffer();
+                if (bufferSize == 0)
+                    return; // äàííûõ áîëüøå íåò
+            }
+            bitBuffer |= static_cast<uint64_t>(fileBuffer[bufferPos++]) << (56 - bitCount);
+            bitCount += 8;
+        }
+    }
 public:
-    BitReader(std::ifstream& in) : in{ in }, currentByte{ 0 }, bitPos{ 8 }{}
-   
+    BitReader(std::ifstream& in) : in{ in }, fileBuffer(BUFFER_SIZE), bufferPos{ 0 }, bufferSize{ 0 }, bitBuffer{ 0 }, bitCount{ 0 }{}
+
+    //âîçâðàùàåò ñëåäóþùèå numBits áèò (0-56), íå ïðîäâèãàÿ ïîçèöèþ ÷òåíèÿ
+    //çà êîíöîì äàííûõ íåäîñòàþùèå áèòû ñ÷èòàþòñÿ íóëåâûìè
+    uint64_t PeekBits(int numBits)
+    {
+        if (numBits <= 0)
+            return 0;
+
+        if (bitCount < numBits)
+            Refill();
+
+        return bitBuffer >> (64 - numBits);
+    }
+
+    //ïðîïóñêàåò numBits áèò (íå áîëüøå, ÷åì áûëî ïîëó÷åíî ïîñëåäíèì PeekBits)
+    void Consume(int numBits)
+    {
+        if (numBits > bitCount)
+            throw std::runtime_error("End of file");
+
+        bitBuffer = (numBits == 64) ? 0 : (bitBuffer << numBits);
+        bitCount -= numBits;
+    }
+
+    //ïðîâåðÿåò, ÷òî â ïîòîêå îñòàëîñü íå ìåíüøå numBits áèò (0-56), íå ïðîäâèãàÿ ïîçèöèþ ÷òåíèÿ
+    //èñïîëüçóåòñÿ äëÿ îáíàðóæåíèÿ êîíöà äàííûõ áåç èñêëþ÷åíèé
+    bool HasBits(int numBits)
+    {
+        if (bitCount < numBits)
+            Refill();
+
+        return bitCount >= numBits;
+    }
+
+    //÷èòàåò îäèí áàéò, åñëè îí åñòü; ïî äîñòèæåíèè êîíöà äàííûõ âîçâðàùàåò false
+    bool TryReadByte(unsigned char& byte)
+    {
+        if (!HasBits(8))
+            return false;
+
+        byte = static_cast<unsigned char>(bitBuffer >> 56);
+        bitBuffer <<= 8;
+        bitCount -= 8;
+        return true;
+    }
+
     //÷èòàåò îäèí áèò
+    //èñêëþ÷åíèå "End of file" îçíà÷àåò îáðûâ äàííûõ (ïîâðåæä¸ííûé ôàéë), à íå øòàòíûé êîíåö
     bool ReadBit()
     {
-        if (bitPos >= 8)
+        if (bitCount == 0)
         {
-            // ×èòàåì íîâûé áàéò
-            if (!in.read(reinterpret_cast<char*>(&currentByte), 1))
-            {
+            Refill();
+            if (bitCount == 0)
                 throw std::runtime_error("End of file");
-            }
-            bitPos = 0;
         }
 
-        bool bit = (currentByte >> (7 - bitPos)) & 1;
-        bitPos++;
+        bool bit = (bitBuffer >> 63) & 1;
+        bitBuffer <<= 1;
+        bitCount--;
         return bit;
     }
 
@@ -106,9 +235,15 @@ public:
             throw std::invalid_argument("Too many bits");
 
         uint64_t result = 0;
-        for (int i = 0; i < numBits; i++)
+        while (numBits > 0)
         {
-            result = (result << 1) | (ReadBit() ? 1 : 0);
+            // çà îäèí ðàç áåðåì íå áîëüøå 56 áèò (ãàðàíòèðîâàííûé îáúåì ïîñëå Refill)
+            int chunk = (numBits > 56) ? 56 : numBits;
+            uint64_t bits = PeekBits(chunk);
+            Consume(chunk);
+
+            result = (result << chunk) | bits;
+            numBits -= chunk;
         }
 
         return result;
@@ -120,6 +255,153 @@ public:
         return static_cast<unsigned char>(ReadBits(8));
     }
 
+    //ïðîïóñêàåò áèòû äî ãðàíèöû áàéòà (îñòàòîê áàéòà, äîïîëíåííîãî íóëÿìè ïðè çàïèñè)
+    void AlignToByte()
+    {
+        int rest = bitCount % 8;
+        bitBuffer <<= rest;
+        bitCount -= rest;
+    }
+
+    //âîçâðàùàåò â ïîòîê áàéòû, ïðî÷èòàííûå áëîêîì, íî åùå íå èñïîëüçîâàííûå
+    //íóæíî âûçûâàòü ïî îêîí÷àíèè äåêîäèðîâàíèÿ çàïèñè àðõèâà, ÷òîáû ñëåäóþùàÿ çàïèñü ÷èòàëàñü ñ ïðàâèëüíîé ïîçèöèè
+    //÷àñòè÷íî ïðî÷èòàííûé áàéò ñ÷èòàåòñÿ èñïîëüçîâàííûì
+    void SyncStream()
+    {
+        streamoff unread = static_cast<streamoff>(bufferSize - bufferPos) + bitCount / 8;
+
+        in.clear();
+        if (unread > 0)
+            in.seekg(-unread, std::ios::cur);
+
+        bufferPos = bufferSize = 0;
+        bitBuffer = 0;
+        bitCount = 0;
+    }
+
+};
+
+//áèòîâûé ïèñàòåëü â áóôåð ïàìÿòè (äëÿ êîäåêîâ, ñîáèðàþùèõ íåñêîëüêî ïîòîêîâ ïåðåä çàïèñüþ â ôàéë)
+//ïîðÿäîê áèòîâ òîò æå, ÷òî ó BitWriter: ñòàðøèé áèò ïåðâûì
+class MemoryBitWriter
+{
+private:
+    vector<unsigned char>& data; // Áóôåð, â êîòîðûé äîïèñûâàþòñÿ áàéòû
+    uint64_t bitBuffer;          // Àêêóìóëÿòîð áèòîâ (áèòû âûðîâíåíû âïðàâî)
+    int bitCount;                // Êîëè÷åñòâî áèòîâ â àêêóìóëÿòîðå (0-63)
+public:
+    MemoryBitWriter(vector<unsigned char>& buffer) : data(buffer), bitBuffer(0), bitCount(0)
+    {
+    }
+
+    //ïèøåò numBits ìëàäøèõ áèòîâ value (0-56), ñòàðøèé áèò ïåðâûì
+    void WriteBits(uint64_t value, int numBits)
+    {
+        if (numBits <= 0)
+            return;
+
+        bitBuffer = (bitBuffer << numBits) | (value & ((uint64_t(1) << numBits) - 1));
+        bitCount += numBits;
+
+        // ïåðåíîñèì öåëûå áàéòû â áóôåð, â àêêóìóëÿòîðå îñòàåòñÿ ìåíüøå 8 áèò
+        while (bitCount >= 8)
+        {
+            bitCount -= 8;
+            data.push_back(static_cast<unsigned char>(bitBuffer >> bitCount));
+        }
+    }
+
+    //äîïèñûâàåò íåïîëíûé áàéò íóëÿìè, âîçâðàùàåò êîëè÷åñòâî äîáàâëåííûõ áèòîâ
+    unsigned char Flush()
+    {
+        unsigned char padding = 0;
+        if (bitCount != 0)
+        {
+            padding = 8 - bitCount;
+            data.push_back(static_cast<unsigned char>(bitBuffer << padding));
+        }
+        bitBuffer = 0;
+        bitCount = 0;
+        return padding;
+    }
+};
+
+//áèòîâûé ÷èòàòåëü èç áóôåðà ïàìÿòè; ïîääåðæèâàåò òîò æå íàáîð îïåðàöèé, ÷òî BitReader
+//(PeekBits, Consume, ReadBit), ïîýòîìó ñ íèì ðàáîòàþò òå æå òàáëèöû äåêîäèðîâàíèÿ
+class MemoryBitReader
+{
+private:
+    const unsigned char* data; // Íà÷àëî äàííûõ
+    size_t size;               // Ðàçìåð äàííûõ â áàéòàõ
+    size_t pos;                // Ïîçèöèÿ ñëåäóþùåãî íåïðî÷èòàííîãî áàéòà
+    uint64_t bitBuffer;        // Áèòîâûé áóôåð: ñëåäóþùèé áèò íàõîäèòñÿ â ñòàðøåì ðàçðÿäå
+    int bitCount;              // Êîëè÷åñòâî äîñòîâåðíûõ áèòîâ â bitBuffer
+
+    //äîçàïîëíÿåò áèòîâûé áóôåð öåëûìè áàéòàìè (íå ìåíåå 57 áèò, åñëè äàííûå åñòü)
+    void Refill()
+    {
+        if (size - pos >= 8)
+        {
+            // áûñòðûé ïóòü: áåðåì ñðàçó 8 áàéò â big-endian ïîðÿäêå
+            uint64_t word = 0;
+            for (int i = 0; i < 8; i++)
+                word = (word << 8) | data[pos + i];
+
+            int bytes = (64 - bitCount) >> 3;
+            bitBuffer |= word >> bitCount;
+            pos += bytes;
+            bitCount += bytes * 8;
+            return;
+        }
+
+        // ìåäëåííûé ïóòü: êîíåö äàííûõ, äîáèðàåì ïî îäíîìó áàéòó
+        while (bitCount <= 56 && pos < size)
+        {
+            bitBuffer |= static_cast<uint64_t>(data[pos++]) << (56 - bitCount);
+            bitCount += 8;
+        }
+    }
+public:
+    MemoryBitReader(const unsigned char* data, size_t size) : data{ data }, size{ size }, pos{ 0 }, bitBuffer{ 0 }, bitCount{ 0 } {}
+
+    //âîçâðàùàåò ñëåäóþùèå numBits áèò (0-56), íå ïðîäâèãàÿ ïîçèöèþ ÷òåíèÿ
+    //çà êîíöîì äàííûõ íåäîñòàþùèå áèòû ñ÷èòàþòñÿ íóëåâûìè
+    uint64_t PeekBits(int numBits)
+    {
+        if (numBits <= 0)
+            return 0;
+
+        if (bitCount < numBits)
+            Refill();
+
+        return bitBuffer >> (64 - numBits);
+    }
+
+    //ïðîïóñêàåò numBits áèò (íå áîëüøå, ÷åì áûëî ïîëó÷åíî ïîñëåäíèì PeekBits)
+    void Consume(int numBits)
+    {
+        if (numBits > bitCount)
+            throw std::runtime_error("End of file");
+
+        bitBuffer = (numBits == 64) ? 0 : (bitBuffer << numBits);
+        bitCount -= numBits;
+    }
+
+    //÷èòàåò îäèí áèò
+    bool ReadBit()
+    {
+        if (bitCount == 0)
+        {
+            Refill();
+            if (bitCount == 0)
+                throw std::runtime_error("End of file");
+        }
+
+        bool bit = (bitBuffer >> 63) & 1;
+        bitBuffer <<= 1;
+        bitCount--;
+        return bit;
+    }
 };
 
 
@@ -2,6 +2,7 @@
 #include <vector>
 #include <array>
 #include <bitset>
+#include <cstdint>
 
 using namespace std;
 
@@ -11,64 +12,105 @@ class BitWriter
 private:
     ofstream& out; //выходной поток, куда будет производится запись
     vector<unsigned char> fileBuffer; // Буфер для файла
-    unsigned char bitBuffer;               // Буфер для битов
-    int bitCount;
-    static constexpr size_t BUFFER_SIZE = 4096;
+    size_t bufferPos;                 // Количество заполненных байт в fileBuffer
+    uint64_t bitBuffer;               // Буфер для битов (64-битный аккумулятор, биты выровнены вправо)
+    int bitCount;                     // Количество битов в аккумуляторе (0-63)
+    static constexpr size_t BUFFER_SIZE = 1 << 16;
     unsigned char paddingBits;
+
+    //переносит полное 64-битное слово из аккумулятора в файловый буфер (старшие байты первыми)
+    void FlushWord(uint64_t word)
+    {
+        if (bufferPos + 8 > BUFFER_SIZE)
+        {
+            WriteFileBuffer();
+        }
+
+        for (int i = 7; i >= 0; i--)
+        {
+            fileBuffer[bufferPos++] = static_cast<unsigned char>(word >> (i * 8));
+        }
+    }
+
+    //пишет заполненную часть файлового буфера в поток
+    void WriteFileBuffer()
+    {
+        out.write(reinterpret_cast<const char*>(fileBuffer.data()), bufferPos);
+        bufferPos = 0;
+    }
 public:
-    BitWriter(std::ofstream& stream) : out(stream), fileBuffer(), bitBuffer(0), bitCount(0), paddingBits(0)
+    BitWriter(std::ofstream& stream) : out(stream), fileBuffer(BUFFER_SIZE), bufferPos(0), bitBuffer(0), bitCount(0), paddingBits(0)
     {
-        fileBuffer.reserve(BUFFER_SIZE);
     }
 
     //получение и сброс дополнительных битов, добавленных после вызова FlushFileBuffer()
     unsigned char GetPaddingBits() { return paddingBits; }
     void ResetPaddingBits() { paddingBits = 0; }
 
-    //пишет один бит сначал в буфер
-    void WriteBit(bool bit)
+    //пишет numBits младших битов value (0-64), старший бит первым
+    void WriteBits(uint64_t value, int numBits)
     {
-        bitBuffer = (bitBuffer << 1) | (bit ? 1 : 0);
-        bitCount++;
+        if (numBits <= 0)
+            return;
 
-        if (bitCount == 8)
-        {
-            // Добавляем байт в файловый буфер
-            fileBuffer.push_back(bitBuffer);
-            bitBuffer = 0;
-            bitCount = 0;
+        if (numBits < 64)
+            value &= (uint64_t(1) << numBits) - 1;
 
-            // Если буфер заполнен, записываем в файл
-            if (fileBuffer.size() >= BUFFER_SIZE)
-            {
-                FlushFileBuffer();
-            }
+        int freeBits = 64 - bitCount;
+        if (numBits < freeBits)
+        {
+            // все биты помещаются в аккумулятор
+            bitBuffer = (bitBuffer << numBits) | value;
+            bitCount += numBits;
+            return;
         }
+
+        // дополняем аккумулятор до полного слова и сбрасываем его в буфер
+        int rest = numBits - freeBits;
+        uint64_t word = (freeBits == 64) ? value : ((bitBuffer << freeBits) | (value >> rest));
+        FlushWord(word);
+
+        bitBuffer = (rest == 0) ? 0 : (value & ((uint64_t(1) << rest) - 1));
+        bitCount = rest;
+    }
+
+    //пишет один бит сначал в буфер
+    void WriteBit(bool bit)
+    {
+        WriteBits(bit ? 1 : 0, 1);
     }
 
     //пишет один байт в буфер
     void WriteByte(unsigned char b)
     {
-        for (int i = 7; i >= 0; i--)
-        {
-            WriteBit((b >> i) & 1);
-        }
+        WriteBits(b, 8);
     }
 
-    //пишет данные буфера в файл
+    //дописывает неполный байт нулями и пишет данные буфера в файл
     void FlushFileBuffer()
     {
-        if (!fileBuffer.empty())
+        if (bitCount % 8 != 0)
         {
-            while (bitCount != 0)
-            {
-                WriteBit(0);
-                paddingBits++;
-            }
+            unsigned char padding = 8 - bitCount % 8;
+            bitBuffer <<= padding;
+            bitCount += padding;
+            paddingBits += padding;
+        }
+
+        // переносим оставшиеся целые байты аккумулятора в файловый буфер
+        if (bufferPos + bitCount / 8 > BUFFER_SIZE)
+        {
+            WriteFileBuffer();
+        }
 
-            out.write(reinterpret_cast<const char*>(fileBuffer.data()), fileBuffer.size());
-            fileBuffer.clear();
+        while (bitCount > 0)
+        {
+            bitCount -= 8;
+            fileBuffer[bufferPos++] = static_cast<unsigned char>(bitBuffer >> bitCount);
         }
+        bitBuffer = 0;
+
+        WriteFileBuffer();
     }
 };
 
@@ -76,26 +118,113 @@ class BitReader
 {
 private:
     ifstream& in;// входной поток, откуда производится чтение данных
-    unsigned char currentByte;//текущий читаемый байт
-    int bitPos;//конкеретный бит в текущем байте
+    vector<unsigned char> fileBuffer; // Буфер для блочного чтения файла
+    size_t bufferPos;  // Позиция следующего непрочитанного байта в fileBuffer
+    size_t bufferSize; // Количество байт, прочитанных в fileBuffer
+    uint64_t bitBuffer; // Битовый буфер: следующий бит находится в старшем разряде
+    int bitCount; // Количество достоверных битов в bitBuffer
+    static constexpr size_t BUFFER_SIZE = 1 << 16;
+
+    //читает очередной блок из потока в файловый буфер
+    void FillFileBuffer()
+    {
+        in.read(reinterpret_cast<char*>(fileBuffer.data()), BUFFER_SIZE);
+        bufferSize = static_cast<size_t>(in.gcount());
+        bufferPos = 0;
+    }
+
+    //дозаполняет битовый буфер целыми байтами (не менее 57 бит, если данные есть)
+    void Refill()
+    {
+        if (bufferSize - bufferPos >= 8)
+        {
+            // быстрый путь: берем сразу 8 байт в big-endian порядке
+            uint64_t word = 0;
+            for (int i = 0; i < 8; i++)
+                word = (word << 8) | fileBuffer[bufferPos + i];
+
+            int bytes = (64 - bitCount) >> 3;
+            bitBuffer |= word >> bitCount;
+            bufferPos += bytes;
+            bitCount += bytes * 8;
+            return;
+        }
+
+        // медленный путь: конец блока, добираем по одному байту
+        while (bitCount <= 56)
+        {
+            if (bufferPos == bufferSize)
+            {
+                FillFileBuffer();
+                if (bufferSize == 0)
+                    return; // данных больше нет
+            }
+            bitBuffer |= static_cast<uint64_t>(fileBuffer[bufferPos++]) << (56 - bitCount);
+            bitCount += 8;
+        }
+    }
 public:
-    BitReader(std::ifstream& in) : in{ in }, currentByte{ 0 }, bitPos{ 8 }{}
-   
+    BitReader(std::ifstream& in) : in{ in }, fileBuffer(BUFFER_SIZE), bufferPos{ 0 }, bufferSize{ 0 }, bitBuffer{ 0 }, bitCount{ 0 }{}
+
+    //возвращает следующие numBits бит (0-56), не продвигая позицию чтения
+    //за концом данных недостающие биты считаются нулевыми
+    uint64_t PeekBits(int numBits)
+    {
+        if (numBits <= 0)
+            return 0;
+
+        if (bitCount < numBits)
+            Refill();
+
+        return bitBuffer >> (64 - numBits);
+    }
+
+    //пропускает numBits бит (не больше, чем было получено последним PeekBits)
+    void Consume(int numBits)
+    {
+        if (numBits > bitCount)
+            throw std::runtime_error("End of file");
+
+        bitBuffer = (numBits == 64) ? 0 : (bitBuffer << numBits);
+        bitCount -= numBits;
+    }
+
+    //проверяет, что в потоке осталось не меньше numBits бит (0-56), не продвигая позицию чтения
+    //используется для обнаружения конца данных без исключений
+    bool HasBits(int numBits)
+    {
+        if (bitCount < numBits)
+            Refill();
+
+        return bitCount >= numBits;
+    }
+
+    //читает один байт, если он есть; по достижении конца данных возвращает false
+    bool TryReadByte(unsigned char& byte)
+    {
+        if (!HasBits(8))
+            return false;
+
+        byte = static_cast<unsigned char>(bitBuffer >> 56);
+        bitBuffer <<= 8;
+        bitCount -= 8;
+        return true;
+    }
+
     //читает один бит
+    //исключение "End of file" означает обрыв данных (повреждённый файл), а не штатный конец
     bool ReadBit()
     {
-        if (bitPos >= 8)
+        if (bitCount == 0)
         {
-            // Читаем новый байт
-            if (!in.read(reinterpret_cast<char*>(&currentByte), 1))
-            {
+            Refill();
+            if (bitCount == 0)
                 throw std::runtime_error("End of file");
-            }
-            bitPos = 0;
         }
 
-        bool bit = (currentByte >> (7 - bitPos)) & 1;
-        bitPos++;
+        bool bit = (bitBuffer >> 63) & 1;
+        bitBuffer <<= 1;
+        bitCount--;
         return bit;
     }
 
@@ -106,9 +235,15 @@ public:
             throw std::invalid_argument("Too many bits");
 
         uint64_t result = 0;
-        for (int i = 0; i < numBits; i++)
+        while (numBits > 0)
         {
-            result = (result << 1) | (ReadBit() ? 1 : 0);
+            // за один раз берем не больше 56 бит (гарантированный объем после Refill)
+            int chunk = (numBits > 56) ? 56 : numBits;
+            uint64_t bits = PeekBits(chunk);
+            Consume(chunk);
+
+            result = (result << chunk) | bits;
+            numBits -= chunk;
         }
 
         return result;
@@ -120,6 +255,153 @@ public:
         return static_cast<unsigned char>(ReadBits(8));
     }
 
+    //пропускает биты до границы байта (остаток байта, дополненного нулями при записи)
+    void AlignToByte()
+    {
+        int rest = bitCount % 8;
+        bitBuffer <<= rest;
+        bitCount -= rest;
+    }
+
+    //возвращает в поток байты, прочитанные блоком, но еще не использованные
+    //нужно вызывать по окончании декодирования записи архива, чтобы следующая запись читалась с правильной позиции
+    //частично прочитанный байт считается использованным
+    void SyncStream()
+    {
+        streamoff unread = static_cast<streamoff>(bufferSize - bufferPos) + bitCount / 8;
+
+        in.clear();
+        if (unread > 0)
+            in.seekg(-unread, std::ios::cur);
+
+        bufferPos = bufferSize = 0;
+        bitBuffer = 0;
+        bitCount = 0;
+    }
+
+};
+
+//битовый писатель в буфер памяти (для кодеков, собирающих несколько потоков перед записью в файл)
+//порядок битов тот же, что у BitWriter: старший бит первым
+class MemoryBitWriter
+{
+private:
+    vector<unsigned char>& data; // Буфер, в который дописываются байты
+    uint64_t bitBuffer;          // Аккумулятор битов (биты выровнены вправо)
+    int bitCount;                // Количество битов в аккумуляторе (0-63)
+public:
+    MemoryBitWriter(vector<unsigned char>& buffer) : data(buffer), bitBuffer(0), bitCount(0)
+    {
+    }
+
+    //пишет numBits младших битов value (0-56), старший бит первым
+    void WriteBits(uint64_t value, int numBits)
+    {
+        if (numBits <= 0)
+            return;
+
+        bitBuffer = (bitBuffer << numBits) | (value & ((uint64_t(1) << numBits) - 1));
+        bitCount += numBits;
+
+        // переносим целые байты в буфер, в аккумуляторе остается меньше 8 бит
+        while (bitCount >= 8)
+        {
+            bitCount -= 8;
+            data.push_back(static_cast<unsigned char>(bitBuffer >> bitCount));
+        }
+    }
+
+    //дописывает неполный байт нулями, возвращает количество добавленных битов
+    unsigned char Flush()
+    {
+        unsigned char padding = 0;
+        if (bitCount != 0)
+        {
+            padding = 8 - bitCount;
+            data.push_back(static_cast<unsigned char>(bitBuffer << padding));
+        }
+        bitBuffer = 0;
+        bitCount = 0;
+        return padding;
+    }
+};
+
+//битовый читатель из буфера памяти; поддерживает тот же набор операций, что BitReader
+//(PeekBits, Consume, ReadBit), поэтому с ним работают те же таблицы декодирования
+class MemoryBitReader
+{
+private:
+    const unsigned char* data; // Начало данных
+    size_t size;               // Размер данных в байтах
+    size_t pos;                // Позиция следующего непрочитанного байта
+    uint64_t bitBuffer;        // Битовый буфер: следующий бит находится в старшем разряде
+    int bitCount;              // Количество достоверных битов в bitBuffer
+
+    //дозаполняет битовый буфер целыми байтами (не менее 57 бит, если данные есть)
+    void Refill()
+    {
+        if (size - pos >= 8)
+        {
+            // быстрый путь: берем сразу 8 байт в big-endian порядке
+            uint64_t word = 0;
+            for (int i = 0; i < 8; i++)
+                word = (word << 8) | data[pos + i];
+
+            int bytes = (64 - bitCount) >> 3;
+            bitBuffer |= word >> bitCount;
+            pos += bytes;
+            bitCount += bytes * 8;
+            return;
+        }
+
+        // медленный путь: конец данных, добираем по одному байту
+        while (bitCount <= 56 && pos < size)
+        {
+            bitBuffer |= static_cast<uint64_t>(data[pos++]) << (56 - bitCount);
+            bitCount += 8;
+        }
+    }
+public:
+    MemoryBitReader(const unsigned char* data, size_t size) : data{ data }, size{ size }, pos{ 0 }, bitBuffer{ 0 }, bitCount{ 0 } {}
+
+    //возвращает следующие numBits бит (0-56), не продвигая позицию чтения
+    //за концом данных недостающие биты считаются нулевыми
+    uint64_t PeekBits(int numBits)
+    {
+        if (numBits <= 0)
+            return 0;
+
+        if (bitCount < numBits)
+            Refill();
+
+        return bitBuffer >> (64 - numBits);
+    }
+
+    //пропускает numBits бит (не больше, чем было получено последним PeekBits)
+    void Consume(int numBits)
+    {
+        if (numBits > bitCount)
+            throw std::runtime_error("End of file");
+
+        bitBuffer = (numBits == 64) ? 0 : (bitBuffer << numBits);
+        bitCount -= numBits;
+    }
+
+    //читает один бит
+    bool ReadBit()
+    {
+        if (bitCount == 0)
+        {
+            Refill();
+            if (bitCount == 0)
+                throw std::runtime_error("End of file");
+        }
+
+        bool bit = (bitBuffer >> 63) & 1;
+        bitBuffer <<= 1;
+        bitCount--;
+        return bit;
+    }
 };
 
 
@@ -0,0 +1,162 @@
+﻿#include <array>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <vector>
+
+#pragma once
+
+using namespace std;
+
+/*
+* Подсчет частот байтов (гистограмма) для энтропийных кодеров
+* Данные обрабатываются большими блоками: байты берутся 64-битными словами,
+* а счет ведется в 4 независимых подгистограммах. Соседние одинаковые байты
+* попадают в разные подгистограммы, поэтому инкременты не ждут друг друга
+* (нет задержек store-to-load на одном счетчике).
+* Подгистограммы 32-битные и сливаются в 64-битные итоги после каждого куска,
+* так что переполнения нет и на файлах больше 4 ГБ.
+*/
+class ByteHistogram
+{
+    array<uint64_t, 256> counts; // Итоговые частоты байтов
+    uint64_t total; // Общее количество учтенных байтов
+
+    // Максимальный кусок, который считается в 32-битных подгистограммах
+    static constexpr size_t MAX_CHUNK_SIZE = size_t(1) << 30;
+    // Размер блока чтения из файла
+    static constexpr size_t READ_BLOCK_SIZE = 1 << 16;
+
+    // Подсчет одного куска (не больше MAX_CHUNK_SIZE байт)
+    void AddChunk(const unsigned char* data, size_t size)
+    {
+        uint32_t sub[4][256] = { 0 };
+
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16)
+        {
+            uint64_t w0;
+            uint64_t w1;
+            memcpy(&w0, data + i, 8);
+            memcpy(&w1, data + i + 8, 8);
+
+            sub[0][w0 & 0xFF]++;
+            sub[1][(w0 >> 8) & 0xFF]++;
+            sub[2][(w0 >> 16) & 0xFF]++;
+            sub[3][(w0 >> 24) & 0xFF]++;
+            sub[0][(w0 >> 32) & 0xFF]++;
+            sub[1][(w0 >> 40) & 0xFF]++;
+            sub[2][(w0 >> 48) & 0xFF]++;
+            sub[3][w0 >> 56]++;
+
+            sub[0][w1 & 0xFF]++;
+            sub[1][(w1 >> 8) & 0xFF]++;
+            sub[2][(w1 >> 16) & 0xFF]++;
+            sub[3][(w1 >> 24) & 0xFF]++;
+            sub[0][(w1 >> 32) & 0xFF]++;
+            sub[1][(w1 >> 40) & 0xFF]++;
+            sub[2][(w1 >> 48) & 0xFF]++;
+            sub[3][w1 >> 56]++;
+        }
+
+        // Хвост куска
+        for (; i < size; i++)
+            sub[i & 3][data[i]]++;
+
+        // Слияние подгистограмм в 64-битные итоги
+        for (int b = 0; b < 256; b++)
+            counts[b] += static_cast<uint64_t>(sub[0][b]) + sub[1][b] + sub[2][b] + sub[3][b];
+
+        total += size;
+    }
+
+public:
+    ByteHistogram() { Reset(); }
+
+    // Сброс всех счетчиков
+    void Reset()
+    {
+        counts.fill(0);
+        total = 0;
+    }
+
+    // Учет блока данных
+    void Add(const unsigned char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            size_t chunk = (size < MAX_CHUNK_SIZE) ? size : MAX_CHUNK_SIZE;
+            AddChunk(data, chunk);
+            data += chunk;
+            size -= chunk;
+        }
+    }
+
+    // Учет всего оставшегося содержимого потока (читается блоками)
+    // Возвращает количество прочитанных байтов
+    uint64_t AddStream(ifstream& in)
+    {
+        vector<unsigned char> block(READ_BLOCK_SIZE);
+        uint64_t readBytes = 0;
+
+        while (true)
+        {
+            in.read(reinterpret_cast<char*>(block.data()), READ_BLOCK_SIZE);
+            size_t blockSize = static_cast<size_t>(in.gcount());
+            if (blockSize == 0)
+                break;
+
+            Add(block.data(), blockSize);
+            readBytes += blockSize;
+        }
+
+        return readBytes;
+    }
+
+    // Частоты байтов
+    const array<uint64_t, 256>& GetCounts() const { return counts; }
+
+    // Частота одного байта
+    uint64_t operator[](int byte) const { return counts[byte]; }
+
+    // Общее количество учтенных байтов
+    uint64_t GetTotal() const { return total; }
+
+    // Количество различных байтов
+    int GetUniqueCount() const
+    {
+        int unique = 0;
+        for (int b = 0; b < 256; b++)
+        {
+            if (counts[b] != 0)
+                unique++;
+        }
+        return unique;
+    }
+
+    // Оценка энтропии нулевого порядка в битах на байт (0-8)
+    // Позволяет заранее оценить, имеет ли смысл энтропийное кодирование данных
+    double GetEntropy() const
+    {
+        if (total == 0)
+            return 0.0;
+
+        double entropy = 0.0;
+        for (int b = 0; b < 256; b++)
+        {
+            if (counts[b] != 0)
+            {
+                double p = static_cast<double>(counts[b]) / static_cast<double>(total);
+                entropy -= p * log2(p);
+            }
+        }
+        return entropy;
+    }
+
+    // Оценка размера в байтах после энтропийного кодирования нулевого порядка
+    uint64_t EstimateCompressedSize() const
+    {
+        return static_cast<uint64_t>(ceil(GetEntropy() * static_cast<double>(total) / 8.0));
+    }
+};
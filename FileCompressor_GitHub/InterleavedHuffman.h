@@ -0,0 +1,258 @@
+﻿#include <iostream>
+#include <fstream>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <atomic>
+#include "FileRW.h"
+#include "Histogram.h"
+#include "StaticHuffman.h"
+
+#pragma once
+
+using namespace std;
+
+/*Offset   Размер                Описание
+      0        2 байта                  Размер таблицы (tableSize) - количество уникальных символов (0-256)
+      2        8 байт                    Размер данных (dataSize) - количество исходных байтов
+     10       переменный          Таблица длин кодов (тот же формат, что у StaticHuffmanManager)
+     ...       переменный            Блоки
+*/
+
+//Исходные данные делятся на блоки по BLOCK_SIZE байт (последний блок может быть короче).
+//Байт с номером i внутри блока кодируется в поток i % 4, то есть каждый блок - это 4 независимых
+//битовых потока, выровненных по байту. Формат блока:
+/*[Таблица переходов] : 4 x 2 байта (uint16_t) - размеры потоков 0-3 в байтах
+[Поток 0] ... [Поток 3] : закодированные данные потоков подряд
+*/
+//Зная размеры потоков, декодер сразу находит начало каждого из них и ведет четыре цепочки
+//декодирования одновременно: битовые позиции потоков не зависят друг от друга, поэтому
+//процессор выполняет обращения к таблице для разных потоков параллельно.
+
+class InterleavedHuffmanManager
+{
+    // Количество чередующихся потоков в блоке
+    static constexpr int STREAM_COUNT = 4;
+    // Размер блока исходных данных
+    static constexpr size_t BLOCK_SIZE = 1 << 16;
+
+    // Размер потока в байтах должен помещаться в элемент таблицы переходов (uint16_t)
+    static_assert((BLOCK_SIZE / STREAM_COUNT) * StaticHuffmanManager::MAX_CODE_LENGTH_LIMIT / 8 <= 0xFFFF,
+        "Stream size does not fit into the jump table");
+
+    // Длины кодов Хаффмана для каждого символа (0 - символ не встречается)
+    array<unsigned char, 256> codeLengths;
+    // Канонические коды Хаффмана для каждого символа
+    array<uint64_t, 256> codes;
+    // Ограничение длины кода (не больше MAX_CODE_LENGTH_LIMIT, чтобы код писался одним вызовом WriteBits)
+    int codeLengthLimit;
+
+    // Буферы потоков текущего блока
+    array<vector<unsigned char>, STREAM_COUNT> streams;
+
+    /*
+    * Кодирование одного блока в 4 потока и запись его в файл
+    * Возвращает количество записанных байтов (вместе с таблицей переходов)
+    */
+    uint64_t encodeBlock(const unsigned char* data, size_t size, ofstream& out)
+    {
+        for (int s = 0; s < STREAM_COUNT; s++)
+            streams[s].clear();
+
+        MemoryBitWriter w0{ streams[0] };
+        MemoryBitWriter w1{ streams[1] };
+        MemoryBitWriter w2{ streams[2] };
+        MemoryBitWriter w3{ streams[3] };
+
+        size_t i = 0;
+        for (; i + STREAM_COUNT <= size; i += STREAM_COUNT)
+        {
+            w0.WriteBits(codes[data[i]], codeLengths[data[i]]);
+            w1.WriteBits(codes[data[i + 1]], codeLengths[data[i + 1]]);
+            w2.WriteBits(codes[data[i + 2]], codeLengths[data[i + 2]]);
+            w3.WriteBits(codes[data[i + 3]], codeLengths[data[i + 3]]);
+        }
+
+        // Хвост блока: меньше 4 байтов, по одному в потоки 0, 1, 2
+        MemoryBitWriter* tail[STREAM_COUNT] = { &w0, &w1, &w2, &w3 };
+        for (; i < size; i++)
+            tail[i % STREAM_COUNT]->WriteBits(codes[data[i]], codeLengths[data[i]]);
+
+        w0.Flush();
+        w1.Flush();
+        w2.Flush();
+        w3.Flush();
+
+        // Таблица переходов: размеры всех потоков
+        uint16_t jumpTable[STREAM_COUNT];
+        uint64_t written = sizeof(jumpTable);
+        for (int s = 0; s < STREAM_COUNT; s++)
+        {
+            jumpTable[s] = static_cast<uint16_t>(streams[s].size());
+            written += streams[s].size();
+        }
+        out.write(reinterpret_cast<char*>(jumpTable), sizeof(jumpTable));
+
+        for (int s = 0; s < STREAM_COUNT; s++)
+            out.write(reinterpret_cast<const char*>(streams[s].data()), streams[s].size());
+
+        return written;
+    }
+
+public:
+    InterleavedHuffmanManager(int codeLengthLimit = StaticHuffmanManager::DEFAULT_CODE_LENGTH_LIMIT)
+        : codeLengthLimit{ (codeLengthLimit < StaticHuffmanManager::MIN_CODE_LENGTH_LIMIT) ? StaticHuffmanManager::MIN_CODE_LENGTH_LIMIT
+            : (codeLengthLimit > StaticHuffmanManager::MAX_CODE_LENGTH_LIMIT) ? StaticHuffmanManager::MAX_CODE_LENGTH_LIMIT : codeLengthLimit }
+    {
+    }
+
+    /*
+    * Метод кодирования файла (сжатие)
+    * Первый проход - подсчет частот и построение канонических кодов,
+    * второй - кодирование блоками по 4 потока
+    */
+    uint64_t EncodeFile(ifstream& in, ofstream& out, atomic<uint64_t>& processedBytes)
+    {
+        codeLengths.fill(0);
+        codes.fill(0);
+
+        // Частоты байтов всего файла
+        ByteHistogram byteFreq;
+        uint64_t dataSize = byteFreq.AddStream(in);
+
+        // Длины кодов (с ограничением) и канонические коды - общий код со StaticHuffmanManager
+        StaticHuffmanManager::BuildCodeLengths(byteFreq.GetCounts().data(), 256, codeLengthLimit, codeLengths.data());
+        StaticHuffmanManager::MakeCanonicalCodes(codeLengths.data(), 256, codes.data());
+
+        // Возвращаемся в начало файла для второго прохода
+        in.clear();
+        in.seekg(0, std::ios::beg);
+
+        uint16_t tableSize = 0; // Количество уникальных символов
+        for (int i = 0; i < 256; i++)
+        {
+            if (codeLengths[i] != 0)
+                tableSize++;
+        }
+
+        out.write(reinterpret_cast<char*>(&tableSize), 2);
+        out.write(reinterpret_cast<char*>(&dataSize), 8);
+
+        // Таблица длин кодов: разреженная (символ + длина) или полная (256 длин)
+        vector<unsigned char> table;
+        if (tableSize < StaticHuffmanManager::SPARSE_TABLE_LIMIT)
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                if (codeLengths[i] != 0)
+                {
+                    table.push_back(static_cast<unsigned char>(i));
+                    table.push_back(codeLengths[i]);
+                }
+            }
+        }
+        else
+        {
+            table.assign(codeLengths.begin(), codeLengths.end());
+        }
+        out.write(reinterpret_cast<const char*>(table.data()), table.size());
+
+        // Кодирование блоками
+        uint64_t compressedSize = 0;
+        vector<unsigned char> block(BLOCK_SIZE);
+        while (true)
+        {
+            in.read(reinterpret_cast<char*>(block.data()), BLOCK_SIZE);
+            size_t blockSize = static_cast<size_t>(in.gcount());
+            if (blockSize == 0)
+                break; // Достигнут конец файла
+
+            compressedSize += encodeBlock(block.data(), blockSize, out);
+            processedBytes.fetch_add(blockSize); // Обновляем прогресс
+        }
+
+        return compressedSize;
+    }
+
+    /*
+    * Метод декодирования файла (распаковка)
+    * Каждый блок читается целиком, затем 4 потока декодируются по очереди символ за символом
+    */
+    void DecodeFile(ifstream& in, ofstream& out, atomic<uint64_t>& processedBytes)
+    {
+        // Шаг 1: Чтение метаданных
+        uint16_t tableSize = 0;
+        in.read(reinterpret_cast<char*>(&tableSize), 2);
+
+        uint64_t dataSize = 0;
+        in.read(reinterpret_cast<char*>(&dataSize), 8);
+
+        // Шаг 2: Чтение таблицы длин кодов
+        array<unsigned char, 256> lengths = { 0 };
+        if (tableSize < StaticHuffmanManager::SPARSE_TABLE_LIMIT)
+        {
+            vector<unsigned char> table(static_cast<size_t>(tableSize) * 2);
+            in.read(reinterpret_cast<char*>(table.data()), table.size());
+            for (int i = 0; i < tableSize; i++)
+                lengths[table[2 * i]] = table[2 * i + 1];
+        }
+        else
+        {
+            in.read(reinterpret_cast<char*>(lengths.data()), 256);
+        }
+
+        // Шаг 3: Таблицы декодирования общие для всех потоков
+        StaticHuffmanManager::DecodeTable decodeTable;
+        decodeTable.Build(lengths.data(), 256);
+
+        // Шаг 4: Декодирование блоков
+        vector<unsigned char> encoded;
+        vector<unsigned char> block(BLOCK_SIZE);
+        uint64_t remaining = dataSize;
+        while (remaining > 0)
+        {
+            size_t blockSize = (remaining < BLOCK_SIZE) ? static_cast<size_t>(remaining) : BLOCK_SIZE;
+
+            uint16_t jumpTable[STREAM_COUNT];
+            in.read(reinterpret_cast<char*>(jumpTable), sizeof(jumpTable));
+
+            size_t encodedSize = 0;
+            for (int s = 0; s < STREAM_COUNT; s++)
+                encodedSize += jumpTable[s];
+
+            encoded.resize(encodedSize);
+            in.read(reinterpret_cast<char*>(encoded.data()), encodedSize);
+            if (static_cast<size_t>(in.gcount()) != encodedSize)
+                throw runtime_error("End of file");
+
+            // Читатели потоков по смещениям из таблицы переходов
+            const unsigned char* start = encoded.data();
+            MemoryBitReader r0{ start, jumpTable[0] };
+            start += jumpTable[0];
+            MemoryBitReader r1{ start, jumpTable[1] };
+            start += jumpTable[1];
+            MemoryBitReader r2{ start, jumpTable[2] };
+            start += jumpTable[2];
+            MemoryBitReader r3{ start, jumpTable[3] };
+
+            // Четыре независимые цепочки декодирования
+            size_t i = 0;
+            for (; i + STREAM_COUNT <= blockSize; i += STREAM_COUNT)
+            {
+                block[i] = static_cast<unsigned char>(decodeTable.Decode(r0));
+                block[i + 1] = static_cast<unsigned char>(decodeTable.Decode(r1));
+                block[i + 2] = static_cast<unsigned char>(decodeTable.Decode(r2));
+                block[i + 3] = static_cast<unsigned char>(decodeTable.Decode(r3));
+            }
+
+            // Хвост блока
+            MemoryBitReader* tail[STREAM_COUNT] = { &r0, &r1, &r2, &r3 };
+            for (; i < blockSize; i++)
+                block[i] = static_cast<unsigned char>(decodeTable.Decode(*tail[i % STREAM_COUNT]));
+
+            out.write(reinterpret_cast<const char*>(block.data()), blockSize);
+            processedBytes.fetch_add(blockSize); // Обновляем прогресс
+            remaining -= blockSize;
+        }
+    }
+};
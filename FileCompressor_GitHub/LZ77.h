@@ -1,455 +1,913 @@
 ﻿#include <iostream>
 #include <fstream>
 #include <vector>
-#include <map>
-#include <list>
-#include <memory>
 #include <array>
-#include <bitset>
 #include <cstdint>
 #include "FileRW.h"
-#include <optional>
+#include "MatchLength.h"
+#include "LongDistanceMatcher.h"
 #include <algorithm>
+#include <cstring>
 
 #pragma once
 
 using namespace std;
 
-//Структура файла: 
+//Структура файла:
 /*Offset          Размер                       Описание
-      0               1 байт                  Дополнение (padding) - количество битов дополнения в конце
-      1                переменный      Последовательность токенов LZ77 (по 25 бит каждый)
+      0               1 байт                  Логарифм размера окна (windowLog): окно = 2^windowLog байт (16-24)
+      1               2 байта                 Максимальная длина совпадения (maxMatch)
+      3               1 байт                  Уровень сжатия (level), с которым создана запись (1-9)
+      4               8 байт                  Размер данных (dataSize) - количество исходных байтов
+     12               переменный      Последовательность токенов LZ77 (битовый поток, дополненный до байта)
 */
 
-//Формат токена LZ77 (25 бит):
-/*Биты    Поле                Описание
-0-8     offset (9 бит)      Смещение назад в поисковом буфере (1-511, 0 = литерал)
-9-14    length (6 бит)      Длина совпадающей последовательности (0-63)
-15-22   next_char (8 бит)   Следующий символ после совпадения (литерал)
-23      isEOF (1 бит)       Флаг конца файла (1 = последний токен)
-24      isValidNextChar     Флаг валидности next_char (0 = токен без литерала)
+//Формат токена LZ77 (переменная длина):
+/*Поле                Описание
+флаг (1 бит)        0 - литерал, 1 - совпадение
+литерал (8 бит)     Байт исходных данных (только у литерала)
+length (гамма-код)  Длина совпадения минус MIN_MATCH: код Элиаса для (length - MIN_MATCH + 1) -
+                    n - 1 нулей, затем само число в n битах
+offset (5 + n бит)  Смещение назад: в 5 битах число n = (разрядность offset - 1), затем младшие n бит
+                    offset (старшая единица не пишется). n = 31 - признак дальнего смещения:
+                    настоящее n записано в следующих 6 битах
 */
+//Короткие совпадения на близких смещениях занимают немного битов, а дальние - ровно столько,
+//сколько нужно для смещения, поэтому большое окно не увеличивает цену каждого токена.
+//Смещения больше окна дает поиск дальних совпадений (LongDistanceMatcher): такие совпадения
+//декодер копирует, перечитывая уже записанную часть выходного файла.
 
 class LZ77
 {
-    // Константы для размеров скользящего окна:
-    static constexpr int SEARCH_SIZE = 511; // Размер словаря(поискового буфера) : 511 байт
-    static constexpr int LOOKAHEAD_SIZE = 63; // Размер буфера предпросмотра: 63 байта
+public:
+    // Допустимые размеры окна (логарифм по основанию 2): 64 КБ - 16 МБ
+    static constexpr int MIN_WINDOW_LOG = 16;
+    static constexpr int MAX_WINDOW_LOG = 24;
+    static constexpr int DEFAULT_WINDOW_LOG = 20; // 1 МБ
+
+    // Допустимые максимальные длины совпадения
+    static constexpr int MIN_MAX_MATCH = 16;
+    static constexpr int MAX_MAX_MATCH = 0xFFFF;
+    static constexpr int DEFAULT_MAX_MATCH = 258;
 
-    // Максимальные значения для токенов (определяются размерами буферов):
-   // offset: 0-511 (9 бит) - смещение в поисковом буфере
-   // length: 0-63 (6 бит) - длина совпадающей последовательности
+    // Уровни сжатия: 1-3 - жадный разбор, 4-6 - ленивый, 7-9 - оптимальный
+    static constexpr int MIN_LEVEL = 1;
+    static constexpr int MAX_LEVEL = 9;
+    static constexpr int DEFAULT_LEVEL = 5;
+
+    static constexpr int MIN_MATCH = 3; // Минимальная длина совпадения
 
     // Структура токена LZ77 - основная единица сжатых данных
     struct LZ77Token
     {
-        uint16_t offset; // Смещение назад в поисковом буфере (0-511)
-        uint8_t length; // Длина совпадающей последовательности (0-63)
-        unsigned char next_char; // Следующий символ после совпадения (литерал)
-        bool isEOF = false; // Флаг конца файла
-        bool isValidNextChar = true; // Флаг валидности next_char (нужен для последнего токена)
+        uint64_t offset; // Смещение назад (0 = литерал)
+        uint32_t length; // Длина совпадения (MIN_MATCH - maxMatch)
+        unsigned char literal; // Байт литерала
     };
 
+    // Запас в конце буфера декодера: CopyMatch может записать до WILD_COPY_SLACK байт за концом совпадения
+    static constexpr size_t WILD_COPY_SLACK = 16;
+
     /*
-   * Запись токена LZ77 в битовый поток
-   * Формат токена (25 бит):
-   * [offset]   : 9 бит  (0-511) - смещение в поисковом буфере
-   * [length]   : 6 бит  (0-63)  - длина совпадения
-   * [next_char]: 8 бит  (0-255) - следующий символ (литерал)
-   * [isEOF]    : 1 бит  (0/1)   - флаг конца файла
-   * [isValidNextChar]: 1 бит (0/1) - флаг валидности next_char
-   * Итого: 9 + 6 + 8 + 1 + 1 = 25 бит
+   * Копирование совпадения длины length со смещением offset в позицию dst (используется декодерами LZ77 и LZH)
+   * Копирование идет кусками по 16 или 8 байт и может захватить до WILD_COPY_SLACK байт после
+   * конца совпадения - там лежат еще не декодированные данные, которые потом перезаписываются.
+   * Перекрытие источника и приемника (offset < length) учитывается:
+   * - offset >= 16 (или >= 8): кусок источника всегда лежит целиком перед куском приемника;
+   * - offset == 1: повтор одного байта - memset;
+   * - offset 2-7: первые 8 байт копируются побайтно, после чего данные периодичны с периодом
+   *   offset * k >= 8, и дальше можно копировать по 8 байт с этим увеличенным смещением.
    */
-
-    void WriteToken(LZ77Token token, BitWriter& writer)
+    static void CopyMatch(unsigned char* dst, size_t offset, size_t length)
     {
-        // Записываем offset (9 бит) - старшие биты первыми
-        for (int i = 8; i >= 0; i--)
+        unsigned char* dstEnd = dst + length;
+
+        if (offset >= 16)
         {
-            bool bit = (token.offset >> i) & 1;
-            writer.WriteBit((token.offset >> i) & 1);
+            const unsigned char* src = dst - offset;
+            do
+            {
+                memcpy(dst, src, 16);
+                dst += 16;
+                src += 16;
+            } while (dst < dstEnd);
+            return;
         }
 
-        // Записываем length (6 бит)
-        for (int i = 5; i >= 0; i--)
+        if (offset == 1)
         {
-            bool bit = (token.length >> i) & 1;
-            writer.WriteBit((token.length >> i) & 1);
+            memset(dst, dst[-1], length);
+            return;
         }
 
-        // Записываем next_char (8 бит = 1 байт)
-        writer.WriteByte(token.next_char);
-
-        // Записываем флаги
-        if (token.isEOF)
-            writer.WriteBit(1);
-        else
-            writer.WriteBit(0);
+        if (offset < 8)
+        {
+            // Разворачиваем образец на первые 8 байт
+            const unsigned char* src = dst - offset;
+            for (int i = 0; i < 8; i++)
+                dst[i] = src[i];
+            dst += 8;
+            offset *= (8 + offset - 1) / offset;
+        }
 
-        if (token.isValidNextChar)
-            writer.WriteBit(1);
-        else
-            writer.WriteBit(0);
+        const unsigned char* src = dst - offset;
+        while (dst < dstEnd)
+        {
+            memcpy(dst, src, 8);
+            dst += 8;
+            src += 8;
+        }
     }
 
-    // Чтение токена LZ77 из битового потока
-    LZ77Token ReadToken(BitReader& reader)
+private:
+    static constexpr int OFFSET_PREFIX_BITS = 5; // Разрядность поля n у смещения
+    static constexpr int OFFSET_ESCAPE = 31; // Значение n, за которым следует 6-битное n дальнего смещения
+    static constexpr int FAR_OFFSET_BITS = 6;
+
+    // Параметры архива (пишутся в заголовок)
+    int windowLog; // Логарифм размера окна
+    size_t windowSize; // Размер окна (максимальное смещение)
+    int maxMatch; // Максимальная длина совпадения
+    int level; // Уровень сжатия
+    bool longDistance; // Поиск дальних совпадений (за пределами окна)
+
+    /*
+   * Способ разбора файла на токены:
+   * Greedy  - всегда берется самое длинное совпадение в текущей позиции;
+   * Lazy    - перед тем как взять совпадение, проверяется следующая позиция: если там совпадение
+   *           длиннее, текущий байт пишется литералом (ленивое сравнение на один шаг, как в zlib);
+   * Optimal - для куска из OPTIMAL_CHUNK байт находятся совпадения во всех позициях, и динамическим
+   *           программированием выбирается разбор с наименьшей суммарной ценой токенов в битах.
+   */
+    enum class ParseStrategy : uint8_t { Greedy, Lazy, Optimal };
+
+    // Параметры уровня: способ разбора, глубина поиска по цепочке и "достаточная" длина совпадения,
+    // после которой поиск прекращается (а оптимальный разбор берет совпадение сразу)
+    struct LevelParams
     {
-        LZ77Token token;
+        ParseStrategy strategy;
+        int chainDepth;
+        int niceLength;
+    };
+
+    static constexpr LevelParams LEVELS[MAX_LEVEL] =
+    {
+        { ParseStrategy::Greedy, 1, 32 },   // 1: одна проба хеш-таблицы
+        { ParseStrategy::Greedy, 4, 64 },   // 2
+        { ParseStrategy::Greedy, 16, 128 }, // 3
+        { ParseStrategy::Lazy, 16, 64 },    // 4
+        { ParseStrategy::Lazy, 32, 128 },   // 5
+        { ParseStrategy::Lazy, 128, 258 },  // 6
+        { ParseStrategy::Optimal, 32, 128 },  // 7
+        { ParseStrategy::Optimal, 64, 258 },  // 8
+        { ParseStrategy::Optimal, 128, 258 }  // 9
+    };
+
+    static constexpr size_t OPTIMAL_CHUNK = 4096; // Размер куска оптимального разбора
+    static constexpr int LITERAL_COST = 9; // Цена литерала в битах
+
+    ParseStrategy strategy; // Способ разбора (по уровню)
+    int niceLength; // Достаточная длина совпадения (не больше maxMatch)
+
+    /*
+   * Поиск совпадений по хеш-цепочкам
+   * Позиции окна хешируются по первым MIN_MATCH байтам. head[h] - последняя позиция
+   * с хешем h, prev[pos % windowSize] - предыдущая позиция с тем же хешем.
+   * Поиск проходит цепочку от ближайших позиций к дальним (не больше chainDepth
+   * кандидатов) и сравнивает байты только у кандидатов с тем же хешем.
+   * Позиции хранятся 32-битными со сдвигом на 1 (0 - пустая ссылка). На файлах больше 4 ГБ
+   * устаревшая ссылка может указать не туда, но кандидат все равно проверяется сравнением байтов
+   * и ограничен окном, поэтому результат остается верным.
+   */
+    static constexpr int HASH_BITS = 16; // Размер таблицы голов цепочек: 65536
 
-        // Читаем offset (9 бит)
-        token.offset = 0;
-        for (int i = 8; i >= 0; i--)
+    int chainDepth; // Максимальное число проверяемых кандидатов
+    vector<uint32_t> head; // Последняя позиция для каждого хеша
+    vector<uint32_t> prev; // Предыдущая позиция с тем же хешем (windowSize элементов)
+
+    /*
+   * Окно кодировщика - один непрерывный буфер: [поисковый буфер][буфер предпросмотра][прочитанное наперед]
+   * Файл читается блоками по windowSize байт в буфер размером 2 * windowSize + maxMatch + OPTIMAL_CHUNK. Окно сдвигается
+   * только изменением индекса cur, а когда блок перестает помещаться, последние windowSize байт
+   * переносятся в начало буфера одним memmove (один раз на windowSize прочитанных байтов).
+   * Память кодировщика определяется только размером окна: 2 * windowSize (буфер) + 4 * windowSize (prev)
+   * + 256 КБ (head), то есть около 6 МБ при окне 1 МБ и около 96 МБ при окне 16 МБ.
+   */
+    vector<unsigned char> window; // Буфер окна
+    size_t cur = 0; // Индекс первого байта буфера предпросмотра (текущая позиция кодирования)
+    size_t end = 0; // Количество достоверных байтов в буфере
+    uint64_t windowStart = 0; // Абсолютная позиция (от начала файла) байта window[0]
+    bool inputEnded = false; // Входной файл прочитан до конца
+
+    // Ограничение параметра диапазоном [low, high]
+    static int Clamp(int value, int low, int high)
+    {
+        return (value < low) ? low : (value > high) ? high : value;
+    }
+
+    // Количество значащих битов числа (value > 0)
+    static int BitWidth(uint64_t value)
+    {
+        int width = 0;
+        while (value != 0)
         {
-            bool bit = reader.ReadBit();
-            token.offset |= (bit << i);
+            width++;
+            value >>= 1;
         }
+        return width;
+    }
 
-        // Читаем length (6 бит)
-        token.length = 0;
-        for (int i = 5; i >= 0; i--)
+    // Хеш первых MIN_MATCH байтов
+    static uint32_t Hash(unsigned char a, unsigned char b, unsigned char c)
+    {
+        uint32_t v = (static_cast<uint32_t>(a) << 16) | (static_cast<uint32_t>(b) << 8) | c;
+        return (v * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    /*
+   * Дочитывает входной файл, пока после cur меньше needed байт (needed <= maxMatch + OPTIMAL_CHUNK)
+   * Возвращает количество прочитанных байтов
+   */
+    size_t FillWindow(ifstream& in, size_t needed)
+    {
+        size_t totalRead = 0;
+        while (!inputEnded && end - cur < needed)
         {
-            bool bit = reader.ReadBit();
-            token.length |= (bit << i);
+            // Блок не помещается - переносим в начало поисковый буфер и непрочитанный хвост
+            if (end + windowSize > window.size())
+            {
+                size_t keepFrom = (cur > windowSize) ? cur - windowSize : 0;
+                memmove(window.data(), window.data() + keepFrom, end - keepFrom);
+                cur -= keepFrom;
+                end -= keepFrom;
+                windowStart += keepFrom;
+            }
+
+            in.read(reinterpret_cast<char*>(window.data() + end), windowSize);
+            size_t readBytes = static_cast<size_t>(in.gcount());
+            if (readBytes < windowSize)
+                inputEnded = true;
+            end += readBytes;
+            totalRead += readBytes;
         }
+        return totalRead;
+    }
 
-        // Читаем next_char (1 байт)
-        token.next_char = reader.ReadByte();
+    // Добавляет позиции [cur, cur + count) в хеш-цепочки и сдвигает окно на count байт
+    // (при поиске дальних совпадений эти байты учитываются и в скользящем хеше)
+    void Advance(size_t count)
+    {
+        size_t chainMask = windowSize - 1;
+        for (size_t i = 0; i < count; i++, cur++)
+        {
+            uint64_t absolute = windowStart + cur;
+            if (longDistance)
+            {
+                // За окном всегда остается не меньше windowSize >= HASH_LENGTH байт истории
+                unsigned char removed = (absolute >= LongDistanceMatcher::HASH_LENGTH) ? window[cur - LongDistanceMatcher::HASH_LENGTH] : 0;
+                ldm.Update(window[cur], removed, absolute + 1);
+
+                // Якорь может попасть внутрь совпадения или куска оптимального разбора - запоминаем
+                // смещение кандидата до начала следующего шага (для совпадений в окне оно не нужно)
+                uint64_t candidate = ldm.GetCandidate(absolute + 1);
+                if (candidate != 0 && absolute + 1 - candidate > windowSize && absolute + 1 >= farSkipUntil)
+                    farPending = absolute + 1 - candidate;
+            }
 
-        // Читаем флаги
-        token.isEOF = reader.ReadBit();
-        token.isValidNextChar = reader.ReadBit();
+            if (cur + MIN_MATCH > end)
+                continue; // Для хеша не хватает байтов (конец файла)
 
-        return token;
+            uint32_t h = Hash(window[cur], window[cur + 1], window[cur + 2]);
+            uint32_t pos = static_cast<uint32_t>(absolute);
+            prev[pos & chainMask] = head[h];
+            head[h] = pos + 1;
+        }
     }
 
+    /*
+   * Поиск самого длинного совпадения для начала буфера предпросмотра
+   * Совпадение может заходить в буфер предпросмотра (смещение меньше длины) -
+   * декодер копирует такие последовательности побайтно, поэтому это допустимо.
+   * При равной длине выбирается меньшее смещение (ближайший кандидат).
+   * Если передан matches, в него пишется каждое улучшение (длина растет, смещение тоже):
+   * для любой длины до найденной ближайший кандидат - первый элемент не короче нее.
+   */
+    void FindMatch(int& bestOffset, int& bestLength, vector<LZ77Token>* matches = nullptr) const
+    {
+        bestOffset = 0;
+        bestLength = 0;
+        if (matches)
+            matches->clear();
+
+        size_t available = end - cur;
+        int maxLength = (available < static_cast<size_t>(maxMatch)) ? static_cast<int>(available) : maxMatch;
+        if (maxLength < MIN_MATCH)
+            return;
+
+        const unsigned char* current = window.data() + cur;
+        uint32_t position = static_cast<uint32_t>(windowStart + cur);
+        size_t chainMask = windowSize - 1;
+
+        uint32_t candidate = head[Hash(current[0], current[1], current[2])];
+        for (int depth = 0; depth < chainDepth && candidate != 0; depth++)
+        {
+            uint32_t candPos = candidate - 1;
+            uint32_t offset = position - candPos;
+            if (offset == 0 || offset > windowSize || offset > cur)
+                break; // Дальше по цепочке позиции только старше
+
+            const unsigned char* match = current - offset;
+
+            // Кандидат, отличающийся в байте bestLength, не может быть длиннее лучшего - не сравниваем его
+            if (match[bestLength] != current[bestLength])
+            {
+                candidate = prev[candPos & chainMask];
+                continue;
+            }
+
+            // Продление совпадения широкими словами (SSE2/AVX2 или 8 байт)
+            int length = static_cast<int>(MatchLength::Get(match, current, maxLength));
+
+            if (length > bestLength)
+            {
+                bestLength = length;
+                bestOffset = static_cast<int>(offset);
+                if (matches && length >= MIN_MATCH)
+                    matches->push_back(LZ77Token{ offset, static_cast<uint32_t>(length), 0 });
+                if (length == maxLength || length >= niceLength)
+                    break; // Длиннее совпадение быть не может или искать дальше не нужно
+            }
+
+            candidate = prev[candPos & chainMask];
+        }
+    }
 
     /*
-   * Сдвиг скользящего окна
-   * Алгоритм:
-   * 1. Переносит processedAmount байт из lookAheadBuffer в searchBuffer
-   * 2. Удаляет эти байты из lookAheadBuffer
-   * 3. Дозаполняет lookAheadBuffer из входного потока до LOOKAHEAD_SIZE
-   * 4. Обрезает searchBuffer до SEARCH_SIZE (удаляет самые старые байты)
+   * Один шаг жадного или ленивого разбора: выбирает и передает в sink токен для позиции cur
+   * (при ленивом разборе перед совпадением могут быть переданы литералы)
    */
-    void SlideWindow(BitReader& reader, vector<unsigned char>& searchBuffer,
-        vector<unsigned char>& lookAheadBuffer, size_t shiftAmount)
+    template <class Sink>
+    void ParseStep(Sink& sink)
     {
-        // Ограничиваем сдвиг размером буфера предпросмотра
-        shiftAmount = (shiftAmount < lookAheadBuffer.size()) ? shiftAmount : lookAheadBuffer.size();
-        if (shiftAmount == 0) return;
+        //если есть совпадения, пишем самое длинное
+        int bestOffset = 0;
+        int bestLength = 0;
+
+        // Ищем совпадения по хеш-цепочкам
+        FindMatch(bestOffset, bestLength);
+
+        // Ленивое сравнение: пока со следующей позиции совпадение длиннее,
+        // текущий байт пишется литералом и совпадение переносится на следующую позицию
+        size_t matchStart = cur;
+        while (strategy == ParseStrategy::Lazy && bestLength >= MIN_MATCH && bestLength < niceLength
+            && matchStart + bestLength < end)
+        {
+            Advance(1);
 
-        // 1. Переносим байты из буфера предпросмотра в поисковый буфер
-        searchBuffer.insert(searchBuffer.end(),
-            lookAheadBuffer.begin(),
-            lookAheadBuffer.begin() + shiftAmount);
+            int nextOffset = 0;
+            int nextLength = 0;
+            FindMatch(nextOffset, nextLength);
+            if (nextLength <= bestLength)
+                break;
+
+            sink(LZ77Token{ 0, 0, window[matchStart] });
+            matchStart = cur;
+            bestOffset = nextOffset;
+            bestLength = nextLength;
+        }
 
-        // 2. Удаляем перенесенные байты из буфера предпросмотра
-        lookAheadBuffer.erase(lookAheadBuffer.begin(),
-            lookAheadBuffer.begin() + shiftAmount);
+        LZ77Token token;
 
-        // 3. Обрезаем поисковый буфер до максимального размера 
-        if (searchBuffer.size() > SEARCH_SIZE)
+        // Если нашли хорошее совпадение (минимум MIN_MATCH символов)
+        if (bestLength >= MIN_MATCH)
         {
-            size_t toRemove = searchBuffer.size() - SEARCH_SIZE;
-            searchBuffer.erase(searchBuffer.begin(),
-                searchBuffer.begin() + toRemove);
+            token.offset = static_cast<uint32_t>(bestOffset);
+            token.length = static_cast<uint32_t>(bestLength);
+            token.literal = 0;
+            Advance(bestLength - (cur - matchStart)); // позиция после matchStart уже могла быть добавлена
         }
+        else // если не нашли совпадений
+        {
+            // Литеральный символ
+            token.offset = 0;
+            token.length = 0;
+            token.literal = window[cur];
+            Advance(1);
+        }
+
+        sink(token);
+    }
 
-        // 4. Дозаполняем буфер предпросмотра из входного потока
-        while (lookAheadBuffer.size() < LOOKAHEAD_SIZE)
+    /*
+   * Дальние совпадения: LongDistanceMatcher предлагает кандидата на якорных позициях, а кодер проверяет
+   * его, перечитывая данные кандидата из входного файла (в окне их уже нет) и сравнивая с окном.
+   * Длина дальнего совпадения ограничена только данными в окне после cur, поэтому длинный повтор
+   * кодируется несколькими токенами с одним смещением: каждый следующий шаг сначала пробует
+   * продолжить предыдущее дальнее совпадение.
+   */
+    static constexpr size_t FAR_MIN_MATCH = 128; // Минимальная длина дальнего совпадения
+    static constexpr size_t FAR_PROBE_SIZE = 256; // Первое чтение при проверке кандидата
+    static constexpr size_t FAR_READ_SIZE = 1 << 16; // Размер последующих чтений
+    static constexpr uint64_t FAR_BACKOFF = 4096; // После неудачной проверки кандидаты пропускаются столько байтов
+
+    LongDistanceMatcher ldm;
+    vector<unsigned char> farBuffer; // Данные кандидата, прочитанные из файла
+    streamoff inputBase = 0; // Позиция начала данных во входном потоке
+    uint64_t farOffset = 0; // Смещение последнего дальнего совпадения (0 - нет)
+    uint64_t farSkipUntil = 0; // До этой позиции кандидаты не проверяются
+    uint64_t farPending = 0; // Смещение кандидата от последнего якоря, еще не проверенное (0 - нет)
+
+    // Длина совпадения данных файла с позиции source и окна с позиции cur (не больше limit)
+    size_t FarMatchLength(ifstream& in, uint64_t source, size_t limit)
+    {
+        in.clear();
+
+        size_t length = 0;
+        size_t chunk = FAR_PROBE_SIZE;
+        while (length < limit)
         {
-            try
-            {
-                unsigned char byte = reader.ReadByte();
-                lookAheadBuffer.push_back(byte);
+            size_t toRead = (limit - length < chunk) ? limit - length : chunk;
+            in.seekg(inputBase + static_cast<streamoff>(source + length), std::ios::beg);
+            in.read(reinterpret_cast<char*>(farBuffer.data()), toRead);
+            size_t got = static_cast<size_t>(in.gcount());
+
+            size_t same = MatchLength::Get(farBuffer.data(), window.data() + cur + length, got);
+            length += same;
+            if (same < toRead)
+                break;
+            chunk = FAR_READ_SIZE;
+        }
 
-            }
-            catch (const std::exception& e)
+        // Возвращаем поток туда, где остановилось чтение окна
+        in.clear();
+        in.seekg(inputBase + static_cast<streamoff>(windowStart + end), std::ios::beg);
+        return length;
+    }
+
+    /*
+   * Попытка взять дальнее совпадение в позиции cur
+   * Возвращает true, если совпадение найдено и передано в sink
+   */
+    template <class Sink>
+    bool TryLongDistanceMatch(ifstream& in, Sink& sink)
+    {
+        size_t available = end - cur;
+        if (available < FAR_MIN_MATCH)
+            return false;
+
+        uint64_t position = windowStart + cur;
+
+        // Сначала продолжение предыдущего дальнего совпадения, затем кандидат от якоря. Якорь мог быть
+        // пройден внутри предыдущего шага: повтор сдвигается вместе с позицией, поэтому смещение то же
+        uint64_t offsets[2] = { farOffset, 0 };
+        if (farPending != farOffset)
+            offsets[1] = farPending;
+        farPending = 0;
+
+        for (int k = 0; k < 2; k++)
+        {
+            uint64_t offset = offsets[k];
+            if (offset <= windowSize || offset > position)
+                continue; // Совпадения в окне находит обычный поиск
+
+            size_t length = FarMatchLength(in, position - offset, available);
+            if (length >= FAR_MIN_MATCH)
             {
-                break; // Достигнут конец файла
+                sink(LZ77Token{ offset, static_cast<uint32_t>(length), 0 });
+                Advance(length);
+                farOffset = offset;
+                return true;
             }
+
+            if (k == 1)
+                farSkipUntil = position + FAR_BACKOFF;
         }
+
+        farOffset = 0;
+        return false;
     }
 
-public:
+    // Цена совпадения в битах (точная для формата токенов LZ77, приближенная для LZH):
+    // lengthCost[length] + цена смещения
+    vector<uint8_t> lengthCost;
+
+    static uint32_t OffsetCost(uint64_t offset)
+    {
+        return OFFSET_PREFIX_BITS + (BitWidth(offset) - 1);
+    }
+
+    // Рабочие массивы оптимального разбора (размер OPTIMAL_CHUNK + 1)
+    vector<uint32_t> optPrice; // optPrice[i] - наименьшая цена первых i байтов куска
+    vector<LZ77Token> optLast; // Последний токен разбора, дающего optPrice[i]
+    vector<LZ77Token> optMatches; // Совпадения в текущей позиции
+    vector<LZ77Token> optTokens; // Выбранные токены куска (в обратном порядке)
+
     /*
-   * Метод декодирования (распаковки) файла
-   * Формат сжатых данных для LZ77:
-   * [Дополнение]    : 1 байт (uint8_t) - количество битов дополнения в конце
-   * [Токены LZ77]   : последовательность токенов по 25 бит каждый
+   * Оптимальный разбор одного куска начиная с cur
+   * Для каждой позиции i куска ищутся совпадения, и из i обновляются цены всех позиций,
+   * достижимых литералом или совпадением любой допустимой длины (с ближайшим смещением для
+   * этой длины). Затем разбор восстанавливается с конца куска по optLast.
+   * Если в позиции найдено совпадение не короче niceLength, кусок заканчивается перед ней,
+   * а совпадение берется целиком: так длинные повторы не просматриваются в каждой позиции.
    */
-    void DecodeFile(ifstream& in, ofstream& out, atomic<uint64_t>& processedBytes)
+    template <class Sink>
+    void ParseOptimalChunk(Sink& sink)
     {
-        BitReader reader{ in };
-        BitWriter writer{ out };
+        size_t available = end - cur;
+        size_t chunk = (available < OPTIMAL_CHUNK) ? available : OPTIMAL_CHUNK;
+
+        if (lengthCost.empty())
+        {
+            lengthCost.assign(maxMatch + 1, 0);
+            for (int length = MIN_MATCH; length <= maxMatch; length++)
+                lengthCost[length] = static_cast<uint8_t>(1 + (2 * BitWidth(length - MIN_MATCH + 1) - 1));
+        }
 
-        vector<unsigned char> outputBuffer;
+        optPrice.assign(chunk + 1, UINT32_MAX);
+        optLast.resize(chunk + 1);
+        optPrice[0] = 0;
 
-        // Выходной буфер для декодированных данных
-        // Нужен для доступа к уже декодированным данным при копировании
-        unsigned char padding = 0;
-        in.read(reinterpret_cast<char*>(&padding), 1);
+        size_t n = chunk; // Фактическая длина куска
+        LZ77Token longMatch{ 0, 0, 0 }; // Длинное совпадение сразу после куска
 
-        try
+        for (size_t i = 0; i < chunk; i++)
         {
-            while (true)
+            int bestOffset = 0;
+            int bestLength = 0;
+            FindMatch(bestOffset, bestLength, &optMatches);
+
+            if (bestLength >= niceLength)
+            {
+                n = i;
+                longMatch = LZ77Token{ static_cast<uint32_t>(bestOffset), static_cast<uint32_t>(bestLength), 0 };
+                break;
+            }
+
+            uint32_t price = optPrice[i];
+
+            // Литерал
+            if (price + LITERAL_COST < optPrice[i + 1])
             {
-                // Читаем очередной токен
-                LZ77Token token = ReadToken(reader);
+                optPrice[i + 1] = price + LITERAL_COST;
+                optLast[i + 1] = LZ77Token{ 0, 1, window[cur] };
+            }
 
-                // Обработка токена конца файла
-                if (token.isEOF)
+            // Совпадения всех длин, не выходящие за кусок
+            uint32_t length = MIN_MATCH;
+            for (const LZ77Token& match : optMatches)
+            {
+                uint32_t maxLength = (match.length < chunk - i) ? match.length : static_cast<uint32_t>(chunk - i);
+                uint32_t basePrice = price + OffsetCost(match.offset);
+                for (; length <= maxLength; length++)
                 {
-                    if (token.offset == 0) // если смещение равно 0, то это токен литерального символа
-                    {
-                        // Литеральный символ
-                        outputBuffer.push_back(token.next_char);
-                        writer.WriteByte(token.next_char);
-                        processedBytes.fetch_add(1);
-                    }
-                    else // если нет -> пишем последовательность
+                    uint32_t matchPrice = basePrice + lengthCost[length];
+                    if (matchPrice < optPrice[i + length])
                     {
-                        // стартовая позиция в буфере, откуда будет начинатся копирование
-                        size_t start_pos = outputBuffer.size() - token.offset;
-
-                        // Копируем совпадающую последовательность
-                        // для этого поочередно пишем каждый символ (байт)
-                        for (int i = 0; i < token.length; i++)
-                        {
-                            unsigned char decoded_char = outputBuffer[start_pos + i];
-                            outputBuffer.push_back(decoded_char);
-                            writer.WriteByte(decoded_char);
-                            processedBytes.fetch_add(1);
-                        }
-
-                        // будет истинно только, если длина совпадения была равна длине буфера предпросмотра
-                        if (token.isValidNextChar)
-                            writer.WriteByte(token.next_char);
+                        optPrice[i + length] = matchPrice;
+                        optLast[i + length] = LZ77Token{ match.offset, length, 0 };
                     }
-                    break; // завершаем декодирование
                 }
+            }
 
-                if (token.offset == 0)
-                {
-                    // Литеральный символ
-                    outputBuffer.push_back(token.next_char);
-                    writer.WriteByte(token.next_char);
-                    processedBytes.fetch_add(1);
-                }
-                else
-                {
-                    // стартовая позиция в буфере, откуда будет начинатся копирование
-                    size_t start_pos = outputBuffer.size() - token.offset;
+            Advance(1);
 
-                    // Копируем совпадающую последовательность
-                    // для этого поочередно пишем каждый символ (байт)
-                    for (int i = 0; i < token.length; i++)
-                    {
-                        unsigned char decoded_char = outputBuffer[start_pos + i];
-                        outputBuffer.push_back(decoded_char);
-                        writer.WriteByte(decoded_char);
-                        processedBytes.fetch_add(1);
-                    }
+            // Пройден якорь с дальним кандидатом: кусок заканчивается здесь, а кандидат проверяется
+            // в начале следующего шага (иначе до конца куска повтор кодировался бы литералами)
+            if (farPending != 0)
+            {
+                n = i + 1;
+                break;
+            }
+        }
 
-                    // Всегда добавляем следующий символ
-                    outputBuffer.push_back(token.next_char);
-                    writer.WriteByte(token.next_char);
-                    processedBytes.fetch_add(1);
+        // Восстановление разбора с конца куска
+        optTokens.clear();
+        for (size_t i = n; i > 0; i -= optLast[i].length)
+            optTokens.push_back(optLast[i]);
 
-                }
+        for (size_t k = optTokens.size(); k > 0; k--)
+        {
+            LZ77Token token = optTokens[k - 1];
+            if (token.offset == 0)
+                token.length = 0;
+            sink(token);
+        }
 
-                // Ограничиваем буфер (для экономии памяти)
-                // Важно: стираются только те данные, которые уже вне SEARCH_SIZE
-                if (outputBuffer.size() > SEARCH_SIZE)
-                {
-                    outputBuffer.erase(outputBuffer.begin(),
-                        outputBuffer.begin() + (outputBuffer.size() - SEARCH_SIZE));
-                }
-            }
+        if (longMatch.length != 0)
+        {
+            sink(longMatch);
+            Advance(longMatch.length);
         }
-        catch (const std::exception& e)
+    }
+
+    /*
+   * Запись токена LZ77 в битовый поток
+   * Возвращает количество записанных битов
+   */
+    int WriteToken(const LZ77Token& token, BitWriter& writer)
+    {
+        if (token.offset == 0)
         {
-            // Конец файла - нормально
-            if (std::string(e.what()) != "End of file")
-            {
-                throw;
-            }
+            // Литерал: флаг 0 и байт
+            writer.WriteBits(token.literal, 9);
+            return 9;
         }
 
-        writer.FlushFileBuffer();
+        // Длина: гамма-код Элиаса числа length - MIN_MATCH + 1
+        uint32_t lengthValue = token.length - MIN_MATCH + 1;
+        int lengthBits = BitWidth(lengthValue);
+
+        // Смещение: разрядность и биты без старшей единицы
+        int offsetBits = BitWidth(token.offset) - 1;
 
-        // если есть padding просто читаем его (нужно для декодирования архива)
-        for (int i = 0; i < padding; i++)
+        writer.WriteBits(1, 1); // флаг совпадения
+        writer.WriteBits(lengthValue, 2 * lengthBits - 1); // n - 1 нулей и число
+
+        int prefixBits = OFFSET_PREFIX_BITS;
+        if (offsetBits < OFFSET_ESCAPE)
+        {
+            writer.WriteBits(static_cast<uint64_t>(offsetBits), OFFSET_PREFIX_BITS);
+        }
+        else
         {
-            reader.ReadBit();
+            writer.WriteBits(OFFSET_ESCAPE, OFFSET_PREFIX_BITS);
+            writer.WriteBits(static_cast<uint64_t>(offsetBits), FAR_OFFSET_BITS);
+            prefixBits += FAR_OFFSET_BITS;
         }
+        writer.WriteBits(token.offset & ((uint64_t(1) << offsetBits) - 1), offsetBits);
+
+        return 1 + (2 * lengthBits - 1) + prefixBits + offsetBits;
     }
 
-    /*
-   * Метод кодирования (сжатия) файла
-   * Возвращает размер сжатых данных в байтах
-   * Формат выходных данных:
-   * [Дополнение]    : 1 байт (uint8_t) - записывается в конце
-   * [Токены LZ77]   : последовательность токенов по 25 бит каждый
-   */
-    uint64_t EncodeFile(ifstream& in, ofstream& out, atomic<uint64_t>& processedBytes)
+    // Чтение токена LZ77 из битового потока
+    LZ77Token ReadToken(BitReader& reader)
     {
-        uint64_t compressedSize = 0;
+        LZ77Token token;
 
-        BitReader reader{ in };
-        BitWriter writer{ out };
+        if (!reader.ReadBit())
+        {
+            token.offset = 0;
+            token.length = 0;
+            token.literal = static_cast<unsigned char>(reader.ReadBits(8));
+            return token;
+        }
+
+        // Длина: считаем нули до первой единицы
+        int zeros = 0;
+        while (!reader.ReadBit())
+        {
+            if (++zeros > 31)
+                throw runtime_error("Invalid LZ77 token");
+        }
+        uint32_t lengthValue = static_cast<uint32_t>((uint64_t(1) << zeros) | reader.ReadBits(zeros));
+        token.length = lengthValue + MIN_MATCH - 1;
 
-        // Инициализация скользящего окна:
-        vector<unsigned char> searchBuffer;
-        vector<unsigned char> lookAheadBuffer;
+        int offsetBits = static_cast<int>(reader.ReadBits(OFFSET_PREFIX_BITS));
+        if (offsetBits == OFFSET_ESCAPE)
+            offsetBits = static_cast<int>(reader.ReadBits(FAR_OFFSET_BITS));
+        token.offset = (uint64_t(1) << offsetBits) | reader.ReadBits(offsetBits);
+        token.literal = 0;
+
+        return token;
+    }
 
-        // Запоминаем позицию для записи метаданных
-        streamsize beg = out.tellp();
 
-        unsigned char zeroByte = 0;
-        out.write(reinterpret_cast<const char*>(&zeroByte), 1);
+public:
+    LZ77(int windowLog = DEFAULT_WINDOW_LOG, int maxMatch = DEFAULT_MAX_MATCH, int level = DEFAULT_LEVEL, bool longDistance = true)
+        : windowLog{ Clamp(windowLog, MIN_WINDOW_LOG, MAX_WINDOW_LOG) },
+        windowSize{ size_t(1) << this->windowLog },
+        maxMatch{ Clamp(maxMatch, MIN_MAX_MATCH, MAX_MAX_MATCH) },
+        level{ Clamp(level, MIN_LEVEL, MAX_LEVEL) },
+        longDistance{ longDistance }
+    {
+        const LevelParams& params = LEVELS[this->level - 1];
+        strategy = params.strategy;
+        chainDepth = params.chainDepth;
+        niceLength = (params.niceLength < this->maxMatch) ? params.niceLength : this->maxMatch;
+    }
 
+    /*
+   * Метод декодирования (распаковки) файла
+   * Размер окна и максимальная длина совпадения берутся из заголовка записи,
+   * а не из параметров конструктора
+   * Выходной файл должен быть открыт и на чтение: дальние совпадения копируются из уже записанной
+   * его части (запись начинается с текущей позиции out)
+   */
+    void DecodeFile(ifstream& in, fstream& out, atomic<uint64_t>& processedBytes)
+    {
+        streamoff outputBase = out.tellp();
+
+        // Чтение заголовка
+        unsigned char storedWindowLog = 0;
+        in.read(reinterpret_cast<char*>(&storedWindowLog), 1);
+        uint16_t storedMaxMatch = 0;
+        in.read(reinterpret_cast<char*>(&storedMaxMatch), 2);
+        unsigned char storedLevel = 0; // Для декодирования не нужен: разбор влияет только на выбор токенов
+        in.read(reinterpret_cast<char*>(&storedLevel), 1);
         uint64_t dataSize = 0;
+        in.read(reinterpret_cast<char*>(&dataSize), 8);
 
-        // Инициализация буфера предпросмотра
-        while (lookAheadBuffer.size() < LOOKAHEAD_SIZE)
-        {
-            try
-            {
-                unsigned char byte = reader.ReadByte();
-                lookAheadBuffer.push_back(byte); //пишет первый байт в буфер предпросмотра
-                processedBytes.fetch_add(1);
-            }
-            catch (const std::exception& e)
+        if (storedWindowLog < MIN_WINDOW_LOG || storedWindowLog > MAX_WINDOW_LOG || storedMaxMatch < MIN_MAX_MATCH)
+            throw runtime_error("Invalid LZ77 header");
+
+        size_t storedWindowSize = size_t(1) << storedWindowLog;
+
+        BitReader reader{ in };
+
+        /*
+       * Декодированные данные накапливаются в плоском буфере размером 2 окна: совпадения копируются
+       * внутри него (CopyMatch), а когда буфер заполняется, готовые данные пишутся в файл одним блоком
+       * и последнее окно переносится в начало буфера.
+       */
+        vector<unsigned char> buffer(2 * storedWindowSize + storedMaxMatch + WILD_COPY_SLACK);
+        size_t pos = 0;     // Позиция записи в буфере
+        size_t flushed = 0; // Начало еще не записанных в файл данных
+        uint64_t decoded = 0; // Количество декодированных байтов (вместе с еще не записанными)
+        uint64_t written = 0; // Количество байтов, записанных в файл
+
+        // Запись готовых данных и перенос последнего окна в начало буфера
+        auto flush = [&]() {
+            out.write(reinterpret_cast<const char*>(buffer.data() + flushed), pos - flushed);
+            processedBytes.fetch_add(pos - flushed);
+            written += pos - flushed;
+            flushed = pos;
+
+            if (pos >= 2 * storedWindowSize)
             {
-                break;
+                memmove(buffer.data(), buffer.data() + pos - storedWindowSize, storedWindowSize);
+                pos = storedWindowSize;
+                flushed = storedWindowSize;
             }
-        }
+        };
 
-        //если буфер предпросмотра пуст -> файл закончился
-        while (!lookAheadBuffer.empty())
+        while (decoded < dataSize)
         {
-            //если есть совпадения, пишем самое длинное
-            int bestOffset = 0;
-            int bestLength = 0;
+            // Читаем очередной токен
+            LZ77Token token = ReadToken(reader);
 
-            // Ищем совпадения в searchBuffer
-            for (int offset = 1; offset <= searchBuffer.size(); offset++)
+            if (token.offset == 0)
             {
-                int searchStart = searchBuffer.size() - offset;
-                int currentLength = 0;
-
-                // offset не может быть больше SEARCH_SIZE
-                if (offset > SEARCH_SIZE) continue;
+                buffer[pos++] = token.literal;
+                decoded++;
+            }
+            else if (token.offset <= storedWindowSize)
+            {
+                if (token.offset > decoded || token.length > storedMaxMatch || token.length > dataSize - decoded)
+                    throw runtime_error("Invalid LZ77 token");
 
-                // Сравниваем символы пока они совпадают
-                while (currentLength < lookAheadBuffer.size() &&
-                    searchStart + currentLength < searchBuffer.size() &&
-                    searchBuffer[searchStart + currentLength] == lookAheadBuffer[currentLength])
-                {
-                    currentLength++;
-                }
+                CopyMatch(buffer.data() + pos, token.offset, token.length);
+                pos += token.length;
+                decoded += token.length;
+            }
+            else
+            {
+                // Дальнее совпадение: источник уже вытеснен из буфера, читаем его из выходного файла
+                if (token.offset > decoded || token.length > dataSize - decoded)
+                    throw runtime_error("Invalid LZ77 token");
 
-                // Обновляем лучшее совпадение
-                if (currentLength > bestLength)
+                uint64_t source = decoded - token.offset;
+                uint64_t remaining = token.length;
+                while (remaining > 0)
                 {
-                    bestLength = currentLength;
-                    bestOffset = offset;
+                    flush();
+
+                    // Источник части должен быть целиком записан в файл, а сама часть - поместиться в буфер
+                    uint64_t chunk = remaining;
+                    if (chunk > token.offset)
+                        chunk = token.offset;
+                    if (chunk > 2 * storedWindowSize + storedMaxMatch - pos)
+                        chunk = 2 * storedWindowSize + storedMaxMatch - pos;
+
+                    out.seekg(outputBase + static_cast<streamoff>(source), std::ios::beg);
+                    out.read(reinterpret_cast<char*>(buffer.data() + pos), static_cast<streamsize>(chunk));
+                    if (static_cast<uint64_t>(out.gcount()) != chunk)
+                        throw runtime_error("LZ77 long-distance match read failed");
+                    out.seekp(outputBase + static_cast<streamoff>(written), std::ios::beg);
+
+                    pos += static_cast<size_t>(chunk);
+                    decoded += chunk;
+                    source += chunk;
+                    remaining -= chunk;
                 }
             }
 
-            LZ77Token token;
+            // Буфер заполнен - пишем готовые данные и оставляем в начале последнее окно
+            if (pos >= 2 * storedWindowSize)
+                flush();
+        }
 
-            // Если нашли хорошее совпадение (минимум 3 символа)
-            if (bestLength >= 3)
-            {
-                token.offset = bestOffset;
-                token.length = bestLength;
+        flush();
 
-                //если длинна совпадения меньше размера буфера предпросмотра
-                if (bestLength < lookAheadBuffer.size())
-                {
-                    // в этом случае next_char будет находится в буфере предпросмотра
-                    token.next_char = lookAheadBuffer[bestLength];
-                    SlideWindow(reader, searchBuffer, lookAheadBuffer, bestLength + 1);
+        // пропускаем дополнение до байта и возвращаем в архив байты, прочитанные читателем наперед
+        reader.AlignToByte();
+        reader.SyncStream();
+    }
 
-                    // если буфер предпросмотра пуст, то обрабатываем конец файла
-                    if (lookAheadBuffer.empty())
-                    {
-                        // помечаем токен как EOF и пишем в файл
-                        token.isEOF = true;
-                        WriteToken(token, writer);
+    // Логарифм размера окна и максимальная длина совпадения (после ограничения диапазонами)
+    int GetWindowLog() const { return windowLog; }
+    int GetMaxMatch() const { return maxMatch; }
+    int GetLevel() const { return level; }
 
-                        compressedSize += 25;
-                        dataSize++;
-                        break;
-                    }
-                }
-                else // если длина совпадения равна длине буфера предпросмотра
-                {
-                    // так как не пишем next_char, то сдвигаем только на bestLength
-                    SlideWindow(reader, searchBuffer, lookAheadBuffer, bestLength);
-                    if (lookAheadBuffer.empty())
-                    {
-                        //если это конец файла, то декодер не будет читать next_char, но для этого нужно указать isValidNextChar = false;
-                        token.next_char = 0;
-                        token.isEOF = true;
-                        token.isValidNextChar = false;
-                        WriteToken(token, writer);
-                        compressedSize += 25;
-                        dataSize++;
-                        break;
-                    }
-                    //если не конец файла, то стандартная обработка - читаем next_char и сдивгаем буфер на 1 (так как прочитали next_char)
-                    token.next_char = lookAheadBuffer[0];
-                    SlideWindow(reader, searchBuffer, lookAheadBuffer, 1);
-                }
-                processedBytes.fetch_add(bestLength + 1);
-            }
-            else // если не нашли совпадений
-            {
-                // Литеральный символ
-                token.offset = 0;
-                token.length = 0;
-                token.next_char = lookAheadBuffer[0];
-                SlideWindow(reader, searchBuffer, lookAheadBuffer, 1);
+    /*
+   * Разбор файла на токены: литералы и самые длинные совпадения в окне
+   * Для каждого токена по порядку вызывается sink(token). Разбор общий для LZ77 и LZH,
+   * которые отличаются только кодированием токенов
+   * Возвращает размер исходных данных
+   */
+    template <class Sink>
+    uint64_t Parse(ifstream& in, atomic<uint64_t>& processedBytes, Sink&& sink)
+    {
+        // Инициализация окна и пустых хеш-цепочек
+        window.assign(2 * windowSize + maxMatch + OPTIMAL_CHUNK, 0);
+        cur = end = 0;
+        windowStart = 0;
+        inputEnded = false;
+        head.assign(size_t(1) << HASH_BITS, 0);
+        prev.assign(windowSize, 0);
+
+        // Таблица якорей дальних совпадений - по размеру входа (с ограничением)
+        if (longDistance)
+        {
+            inputBase = in.tellg();
+            in.seekg(0, std::ios::end);
+            uint64_t inputSize = static_cast<uint64_t>(in.tellg() - inputBase);
+            in.seekg(inputBase, std::ios::beg);
+
+            ldm.Reset(inputSize);
+            farBuffer.resize(FAR_READ_SIZE);
+            farOffset = 0;
+            farSkipUntil = 0;
+            farPending = 0;
+        }
 
-                // если после cдвига дошли до конца файла
-                if (lookAheadBuffer.empty())
-                {
-                    dataSize++;
-                    token.isEOF = true;
-                    WriteToken(token, writer);
-                    compressedSize += 25;
+        // Оптимальному разбору нужен в буфере весь кусок и максимальное совпадение за ним
+        size_t lookahead = (strategy == ParseStrategy::Optimal) ? maxMatch + OPTIMAL_CHUNK : maxMatch;
 
-                    break;
-                }
+        uint64_t dataSize = 0;
+        size_t readBytes = FillWindow(in, lookahead);
+        processedBytes.fetch_add(readBytes);
+        dataSize += readBytes;
 
-                processedBytes.fetch_add(1);
+        //если буфер предпросмотра пуст -> файл закончился
+        while (cur < end)
+        {
+            if (longDistance && TryLongDistanceMatch(in, sink))
+            {
+                // Взято дальнее совпадение
+            }
+            else if (strategy == ParseStrategy::Optimal)
+            {
+                ParseOptimalChunk(sink);
+            }
+            else
+            {
+                ParseStep(sink);
             }
 
-            // пишем сформированый токен
-            WriteToken(token, writer);
-            compressedSize += 24;
-            dataSize++;
+            // дочитываем файл
+            readBytes = FillWindow(in, lookahead);
+            processedBytes.fetch_add(readBytes);
+            dataSize += readBytes;
         }
 
+        return dataSize;
+    }
+
+    /*
+   * Метод кодирования (сжатия) файла
+   * Возвращает размер сжатых данных в байтах
+   */
+    uint64_t EncodeFile(ifstream& in, ofstream& out, atomic<uint64_t>& processedBytes)
+    {
+        uint64_t compressedSize = 0;
+
+        // Запоминаем позицию для записи метаданных
+        streamsize beg = out.tellp();
+
+        unsigned char headerWindowLog = static_cast<unsigned char>(windowLog);
+        uint16_t headerMaxMatch = static_cast<uint16_t>(maxMatch);
+        unsigned char headerLevel = static_cast<unsigned char>(level);
+        uint64_t dataSize = 0;
+        out.write(reinterpret_cast<const char*>(&headerWindowLog), 1);
+        out.write(reinterpret_cast<const char*>(&headerMaxMatch), 2);
+        out.write(reinterpret_cast<const char*>(&headerLevel), 1);
+        out.write(reinterpret_cast<const char*>(&dataSize), 8); // заглушка, пишется в конце
+
+        BitWriter writer{ out };
+
+        // пишем токены по мере разбора
+        dataSize = Parse(in, processedBytes, [&](const LZ77Token& token) { compressedSize += WriteToken(token, writer); });
+
         writer.FlushFileBuffer();
 
         unsigned char padding = writer.GetPaddingBits();
 
+        // Возвращаемся и пишем размер данных
         streampos encodedDataEnd = out.tellp();
-        out.seekp(beg, std::ios::beg);
-
-    
-        out.write(reinterpret_cast<const char*>(&padding), 1);
-
+        out.seekp(static_cast<streamoff>(beg) + 4, std::ios::beg);
+        out.write(reinterpret_cast<const char*>(&dataSize), 8);
         out.seekp(encodedDataEnd);
 
-
-        return compressedSize / 8;
+        return (compressedSize + padding) / 8;
     }
 };
-
-
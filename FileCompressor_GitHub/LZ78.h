@@ -41,26 +41,20 @@ class LZ78
 
 	void WriteToken(LZ78Token token, BitWriter& writer)
 	{
-		for (int i = 15; i >= 0; i--)
-		{
-			writer.WriteBit((token.index >> i) & 1);
-		}
-
-		writer.WriteByte(token.next_byte);
+		// индекс (16 бит) и символ (8 бит) пишутся одним вызовом
+		writer.WriteBits((static_cast<uint32_t>(token.index) << 8) | token.next_byte, 24);
 	}
 
 	LZ78Token ReadToken(BitReader& reader)
 	{
 		LZ78Token token;
 
-		token.index = 0;
-		for (int i = 15; i >= 0; i--)  // от 8 до 0 (старший -> младший)
-		{
-			bool bit = reader.ReadBit();
-			token.index |= (bit << i);  // старший бит в старшую позицию
-		}
+		// индекс (16 бит) и символ (8 бит) берутся из битового буфера одним обращением
+		uint32_t packed = static_cast<uint32_t>(reader.PeekBits(24));
+		reader.Consume(24);
 
-		token.next_byte = reader.ReadByte();
+		token.index = static_cast<uint16_t>(packed >> 8);
+		token.next_byte = static_cast<unsigned char>(packed);
 
 		return token;
 	}
@@ -79,9 +73,11 @@ public:
 
 		streamsize beg = out.tellp();
 
-		unsigned char zeroByte = 0;
-		out.write(reinterpret_cast<const char*>(&zeroByte), 8);
-		out.write(reinterpret_cast<const char*>(&zeroByte), 2);
+		// заглушки для tokenCount и currentSize (для пустого файла так и останутся нулевыми)
+		uint64_t zeroTokenCount = 0;
+		uint16_t zeroCurrentSize = 0;
+		out.write(reinterpret_cast<const char*>(&zeroTokenCount), 8);
+		out.write(reinterpret_cast<const char*>(&zeroCurrentSize), 2);
 
 		// число записанных токенов
 		uint64_t tokenCount = 0;
@@ -92,7 +88,12 @@ public:
 		vector<unsigned char> current;//текущая последовательность
 
 		//первый байт пишем в файл как есть
-		unsigned char byte = reader.ReadByte();
+		unsigned char byte;
+		if (!reader.TryReadByte(byte))
+		{
+			// пустой файл: в заголовке остаются нулевые tokenCount и currentSize
+			return compressedSize;
+		}
 		writer.WriteByte(byte);
 
 		compressedSize += 1;
@@ -112,17 +113,9 @@ public:
 		current.clear();
 
 		// начинаем кодирование
-		while (true)
+		while (reader.TryReadByte(byte))
 		{
-			try
-			{
-				byte = reader.ReadByte();
-				processedBytes.fetch_add(1);
-			}
-			catch (exception e)
-			{
-				break;
-			}
+			processedBytes.fetch_add(1);
 
 			// Формируем кандидата - текущую последовательность + новый байт
 			vector<uint8_t> candidate = current; // Копируем уже найденную часть
@@ -186,15 +179,9 @@ public:
 				dictionary.clear();
 
 				// далее повтрояем то, что делали в начале кодирования
-				try
-				{
-					byte = reader.ReadByte();
-					processedBytes.fetch_add(1);
-				}
-				catch (exception e)
-				{
+				if (!reader.TryReadByte(byte))
 					break;
-				}
+				processedBytes.fetch_add(1);
 
 				writer.WriteByte(byte);
 				compressedSize += 1;
@@ -259,6 +246,10 @@ public:
 
 		int next_index = 2;
 
+		// пустой файл не содержит ни одного токена
+		if (tokenCount == 0)
+			return;
+
 		// первый байт пишем как есть
 		unsigned char byte = reader.ReadByte();
 		writer.WriteByte(byte);
@@ -312,18 +303,16 @@ public:
 
 		for (int i = 0; i < currentSize; i++)
 		{
-			try
-			{
-				byte = reader.ReadByte();
-				writer.WriteByte(byte);
-				processedBytes.fetch_add(1);
-			}
-			catch (exception e)
-			{
+			if (!reader.TryReadByte(byte))
 				break;
-			}
+
+			writer.WriteByte(byte);
+			processedBytes.fetch_add(1);
 		}
 
 		writer.FlushFileBuffer();
+
+		// возвращаем в архив байты, прочитанные читателем наперед
+		reader.SyncStream();
 	}
 };
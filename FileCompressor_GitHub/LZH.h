@@ -0,0 +1,302 @@
+﻿#include <iostream>
+#include <fstream>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <stdexcept>
+#include "FileRW.h"
+#include "StaticHuffman.h"
+#include "LZ77.h"
+
+#pragma once
+
+using namespace std;
+
+/*Offset   Размер                Описание
+      0        1 байт                    Логарифм размера окна (windowLog): окно = 2^windowLog байт
+      1        1 байт                    Уровень сжатия (level) разбора LZ77 (1-9)
+      2       переменный            Блоки (битовый поток, в конце дополненный до байта)
+*/
+
+//LZ77 + Хаффман (как в Deflate): файл разбирается тем же поиском совпадений, что и в LZ77,
+//а токены кодируются двумя таблицами канонических кодов Хаффмана, которые строятся заново
+//для каждого блока из BLOCK_TOKENS токенов:
+//- алфавит литералов/длин: 0-255 - литералы, 256 - конец блока, 257-272 - классы длины;
+//- алфавит смещений: 48 классов (покрывают окно до 16 МБ).
+//Класс числа v (длина - MIN_MATCH или смещение - 1): для v < 4 класс равен v, иначе класс
+//определяется двумя старшими битами v, а остальные биты пишутся как есть (дополнительные биты).
+/*Формат блока:
+[Последний блок]     : 1 бит
+[Длины кодов]        : LITLEN_SYMBOLS + DIST_SYMBOLS длин по 4 бита (0 - символа нет в блоке)
+[Символы]            : код литерала/длины, для длины - ее доп. биты, код смещения и его доп. биты
+[Конец блока]        : код символа END_OF_BLOCK
+*/
+
+class LZHCoder
+{
+    static constexpr int END_OF_BLOCK = 256; // Символ конца блока
+    static constexpr int LENGTH_SYMBOLS = 16; // Классы длины (длины 3-258)
+    static constexpr int LITLEN_SYMBOLS = 257 + LENGTH_SYMBOLS; // Литералы, конец блока и классы длины
+    static constexpr int DIST_SYMBOLS = 2 * LZ77::MAX_WINDOW_LOG; // Классы смещения
+    static constexpr int MAX_MATCH = 258; // Максимальная длина совпадения
+    static constexpr int CODE_LENGTH_LIMIT = 15; // Длина кода помещается в 4 бита
+    static constexpr int CODE_LENGTH_BITS = 4;
+    static constexpr size_t BLOCK_TOKENS = 1 << 16; // Количество токенов в блоке
+
+    int windowLog; // Логарифм размера окна
+    int level; // Уровень сжатия (способ разбора LZ77)
+
+    // Токены текущего блока и частоты их символов
+    vector<LZ77::LZ77Token> tokens;
+    array<uint64_t, LITLEN_SYMBOLS> litlenFreq;
+    array<uint64_t, DIST_SYMBOLS> distFreq;
+
+    // Класс числа v и количество его дополнительных битов
+    static int SlotOf(uint32_t v, int& extraBits)
+    {
+        if (v < 4)
+        {
+            extraBits = 0;
+            return static_cast<int>(v);
+        }
+
+        int n = 0; // Номер старшего единичного бита
+        while ((v >> (n + 1)) != 0)
+            n++;
+
+        extraBits = n - 1;
+        return 2 * n + static_cast<int>((v >> (n - 1)) & 1);
+    }
+
+    // Наименьшее число класса slot и количество его дополнительных битов
+    static uint32_t SlotBase(int slot, int& extraBits)
+    {
+        if (slot < 4)
+        {
+            extraBits = 0;
+            return static_cast<uint32_t>(slot);
+        }
+
+        int n = slot / 2;
+        extraBits = n - 1;
+        return static_cast<uint32_t>(2 | (slot & 1)) << (n - 1);
+    }
+
+    // Учет токена в текущем блоке
+    void AddToken(const LZ77::LZ77Token& token)
+    {
+        int extraBits = 0;
+        if (token.offset == 0)
+        {
+            litlenFreq[token.literal]++;
+        }
+        else
+        {
+            litlenFreq[257 + SlotOf(token.length - LZ77::MIN_MATCH, extraBits)]++;
+            distFreq[SlotOf(static_cast<uint32_t>(token.offset - 1), extraBits)]++;
+        }
+        tokens.push_back(token);
+    }
+
+    /*
+    * Запись блока: построение таблиц кодов по частотам блока и кодирование его токенов
+    * Возвращает количество записанных битов
+    */
+    uint64_t WriteBlock(BitWriter& writer, bool isLast)
+    {
+        litlenFreq[END_OF_BLOCK] = 1;
+
+        array<unsigned char, LITLEN_SYMBOLS> litlenLengths;
+        array<unsigned char, DIST_SYMBOLS> distLengths;
+        array<uint64_t, LITLEN_SYMBOLS> litlenCodes;
+        array<uint64_t, DIST_SYMBOLS> distCodes;
+
+        // Длины кодов (с ограничением) и канонические коды - общий код со StaticHuffmanManager
+        StaticHuffmanManager::BuildCodeLengths(litlenFreq.data(), LITLEN_SYMBOLS, CODE_LENGTH_LIMIT, litlenLengths.data());
+        StaticHuffmanManager::BuildCodeLengths(distFreq.data(), DIST_SYMBOLS, CODE_LENGTH_LIMIT, distLengths.data());
+        StaticHuffmanManager::MakeCanonicalCodes(litlenLengths.data(), LITLEN_SYMBOLS, litlenCodes.data());
+        StaticHuffmanManager::MakeCanonicalCodes(distLengths.data(), DIST_SYMBOLS, distCodes.data());
+
+        uint64_t bits = 1 + static_cast<uint64_t>(LITLEN_SYMBOLS + DIST_SYMBOLS) * CODE_LENGTH_BITS;
+
+        writer.WriteBits(isLast ? 1 : 0, 1);
+        for (int i = 0; i < LITLEN_SYMBOLS; i++)
+            writer.WriteBits(litlenLengths[i], CODE_LENGTH_BITS);
+        for (int i = 0; i < DIST_SYMBOLS; i++)
+            writer.WriteBits(distLengths[i], CODE_LENGTH_BITS);
+
+        for (const LZ77::LZ77Token& token : tokens)
+        {
+            if (token.offset == 0)
+            {
+                writer.WriteBits(litlenCodes[token.literal], litlenLengths[token.literal]);
+                bits += litlenLengths[token.literal];
+                continue;
+            }
+
+            int lengthExtra = 0;
+            uint32_t lengthValue = token.length - LZ77::MIN_MATCH;
+            int lengthSymbol = 257 + SlotOf(lengthValue, lengthExtra);
+            writer.WriteBits(litlenCodes[lengthSymbol], litlenLengths[lengthSymbol]);
+            writer.WriteBits(lengthValue, lengthExtra); // пишутся только младшие lengthExtra бит
+
+            int distExtra = 0;
+            uint32_t distValue = static_cast<uint32_t>(token.offset - 1);
+            int distSymbol = SlotOf(distValue, distExtra);
+            writer.WriteBits(distCodes[distSymbol], distLengths[distSymbol]);
+            writer.WriteBits(distValue, distExtra);
+
+            bits += litlenLengths[lengthSymbol] + lengthExtra + distLengths[distSymbol] + distExtra;
+        }
+
+        writer.WriteBits(litlenCodes[END_OF_BLOCK], litlenLengths[END_OF_BLOCK]);
+        bits += litlenLengths[END_OF_BLOCK];
+
+        // Начинаем новый блок
+        tokens.clear();
+        litlenFreq.fill(0);
+        distFreq.fill(0);
+
+        return bits;
+    }
+
+public:
+    LZHCoder(int windowLog = LZ77::DEFAULT_WINDOW_LOG, int level = LZ77::DEFAULT_LEVEL)
+        : windowLog{ (windowLog < LZ77::MIN_WINDOW_LOG) ? LZ77::MIN_WINDOW_LOG
+            : (windowLog > LZ77::MAX_WINDOW_LOG) ? LZ77::MAX_WINDOW_LOG : windowLog },
+        level{ (level < LZ77::MIN_LEVEL) ? LZ77::MIN_LEVEL : (level > LZ77::MAX_LEVEL) ? LZ77::MAX_LEVEL : level }
+    {
+    }
+
+    /*
+    * Метод кодирования файла (сжатие)
+    * Возвращает размер сжатых данных в байтах
+    */
+    uint64_t EncodeFile(ifstream& in, ofstream& out, atomic<uint64_t>& processedBytes)
+    {
+        unsigned char headerWindowLog = static_cast<unsigned char>(windowLog);
+        unsigned char headerLevel = static_cast<unsigned char>(level);
+        out.write(reinterpret_cast<const char*>(&headerWindowLog), 1);
+        out.write(reinterpret_cast<const char*>(&headerLevel), 1);
+
+        BitWriter writer{ out };
+        uint64_t compressedSize = 0; // Размер сжатых данных в битах
+
+        tokens.clear();
+        tokens.reserve(BLOCK_TOKENS);
+        litlenFreq.fill(0);
+        distFreq.fill(0);
+
+        // Разбор файла - тот же, что у LZ77; заполненный блок сразу кодируется
+        LZ77 parser{ windowLog, MAX_MATCH, level, false }; // дальние совпадения не укладываются в алфавит расстояний
+        parser.Parse(in, processedBytes, [&](const LZ77::LZ77Token& token)
+            {
+                AddToken(token);
+                if (tokens.size() == BLOCK_TOKENS)
+                    compressedSize += WriteBlock(writer, false);
+            });
+
+        // Последний блок (может быть пустым)
+        compressedSize += WriteBlock(writer, true);
+
+        writer.FlushFileBuffer();
+        unsigned char padding = writer.GetPaddingBits();
+
+        return (compressedSize + padding) / 8;
+    }
+
+    /*
+    * Метод декодирования файла (распаковка)
+    * Декодированные данные накапливаются в плоском буфере размером 2 окна: совпадения копируются
+    * внутри него, а когда буфер заполняется, готовые данные пишутся в файл одним блоком
+    * и последнее окно переносится в начало буфера.
+    */
+    void DecodeFile(ifstream& in, ofstream& out, atomic<uint64_t>& processedBytes)
+    {
+        unsigned char storedWindowLog = 0;
+        in.read(reinterpret_cast<char*>(&storedWindowLog), 1);
+        unsigned char storedLevel = 0; // Для декодирования не нужен
+        in.read(reinterpret_cast<char*>(&storedLevel), 1);
+        if (storedWindowLog < LZ77::MIN_WINDOW_LOG || storedWindowLog > LZ77::MAX_WINDOW_LOG)
+            throw runtime_error("Invalid LZH header");
+
+        size_t windowSize = size_t(1) << storedWindowLog;
+
+        BitReader reader{ in };
+
+        vector<unsigned char> buffer(2 * windowSize + MAX_MATCH + LZ77::WILD_COPY_SLACK);
+        size_t pos = 0;     // Позиция записи в буфере
+        size_t flushed = 0; // Начало еще не записанных в файл данных
+        uint64_t decoded = 0; // Общее количество декодированных байтов
+
+        StaticHuffmanManager::DecodeTable litlenTable;
+        StaticHuffmanManager::DecodeTable distTable;
+        array<unsigned char, LITLEN_SYMBOLS> litlenLengths;
+        array<unsigned char, DIST_SYMBOLS> distLengths;
+
+        bool isLast = false;
+        while (!isLast)
+        {
+            // Заголовок блока: флаг и длины кодов
+            isLast = reader.ReadBit();
+            for (int i = 0; i < LITLEN_SYMBOLS; i++)
+                litlenLengths[i] = static_cast<unsigned char>(reader.ReadBits(CODE_LENGTH_BITS));
+            for (int i = 0; i < DIST_SYMBOLS; i++)
+                distLengths[i] = static_cast<unsigned char>(reader.ReadBits(CODE_LENGTH_BITS));
+
+            litlenTable.Build(litlenLengths.data(), LITLEN_SYMBOLS);
+            distTable.Build(distLengths.data(), DIST_SYMBOLS);
+
+            while (true)
+            {
+                int symbol = litlenTable.Decode(reader);
+                if (symbol < END_OF_BLOCK)
+                {
+                    buffer[pos++] = static_cast<unsigned char>(symbol);
+                }
+                else if (symbol == END_OF_BLOCK)
+                {
+                    break;
+                }
+                else
+                {
+                    int extraBits = 0;
+                    uint32_t length = SlotBase(symbol - 257, extraBits);
+                    length += static_cast<uint32_t>(reader.ReadBits(extraBits)) + LZ77::MIN_MATCH;
+
+                    int distSymbol = distTable.Decode(reader);
+                    uint32_t offset = SlotBase(distSymbol, extraBits);
+                    offset += static_cast<uint32_t>(reader.ReadBits(extraBits)) + 1;
+
+                    if (length > MAX_MATCH || offset > windowSize || offset > decoded + (pos - flushed))
+                        throw runtime_error("Invalid LZH token");
+
+                    // Копирование с учетом перекрытия - общее с декодером LZ77
+                    LZ77::CopyMatch(buffer.data() + pos, offset, length);
+                    pos += length;
+                }
+
+                // Буфер заполнен - пишем готовые данные и оставляем в начале последнее окно
+                if (pos >= 2 * windowSize)
+                {
+                    out.write(reinterpret_cast<const char*>(buffer.data() + flushed), pos - flushed);
+                    processedBytes.fetch_add(pos - flushed);
+                    decoded += pos - flushed;
+
+                    memmove(buffer.data(), buffer.data() + pos - windowSize, windowSize);
+                    pos = windowSize;
+                    flushed = windowSize;
+                }
+            }
+        }
+
+        out.write(reinterpret_cast<const char*>(buffer.data() + flushed), pos - flushed);
+        processedBytes.fetch_add(pos - flushed);
+
+        // пропускаем дополнение до байта и возвращаем в архив байты, прочитанные читателем наперед
+        reader.AlignToByte();
+        reader.SyncStream();
+    }
+};
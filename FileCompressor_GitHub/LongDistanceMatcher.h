@@ -0,0 +1,95 @@
+﻿#include <vector>
+#include <cstdint>
+
+#pragma once
+
+using namespace std;
+
+/*
+* Поиск кандидатов для совпадений на больших расстояниях (дальше окна LZ77)
+* По всему входу считается скользящий полиномиальный хеш последних HASH_LENGTH байтов.
+* Позиция становится якорем, если старшие ANCHOR_BITS бит хеша нулевые - в среднем одна
+* позиция из 2^ANCHOR_BITS. Якоря определяются содержимым, поэтому в повторяющемся участке
+* они попадают в те же места, на каком бы расстоянии ни был повтор.
+* Якоря запоминаются в таблице фиксированного размера (не больше 2^MAX_TABLE_BITS записей по 16 байт):
+* новый якорь вытесняет старый с тем же индексом, так что память не зависит от размера входа.
+* Для якоря таблица возвращает позицию предыдущего якоря с тем же хешем - кандидата, который
+* затем проверяется сравнением данных (это делает кодер LZ77).
+*/
+class LongDistanceMatcher
+{
+public:
+    static constexpr int HASH_LENGTH = 64; // Количество байтов в скользящем хеше
+
+private:
+    static constexpr int ANCHOR_BITS = 8; // Якорь - в среднем каждая 256-я позиция
+    static constexpr int MIN_TABLE_BITS = 10;
+    static constexpr int MAX_TABLE_BITS = 20; // 16 МБ
+    static constexpr uint64_t PRIME = 0x100000001B3ull; // Множитель скользящего хеша
+
+    struct Entry
+    {
+        uint64_t position; // Позиция сразу после хешированных байтов (0 - пустая запись)
+        uint32_t check; // Младшие биты хеша для отсева ложных кандидатов
+    };
+
+    vector<Entry> table;
+    int tableBits = MIN_TABLE_BITS;
+    uint64_t hash = 0;
+    uint64_t removePower = 1; // PRIME^HASH_LENGTH - вклад байта, выходящего из хеша
+
+    uint64_t candidateFor = 0; // Позиция, для которой найден кандидат
+    uint64_t candidate = 0; // Позиция кандидата
+
+public:
+    LongDistanceMatcher()
+    {
+        for (int i = 0; i < HASH_LENGTH; i++)
+            removePower *= PRIME;
+    }
+
+    // Подготовка к новому файлу: размер таблицы выбирается по размеру данных (с ограничением)
+    void Reset(uint64_t dataSize)
+    {
+        tableBits = MIN_TABLE_BITS;
+        while (tableBits < MAX_TABLE_BITS && (uint64_t(1) << (tableBits + ANCHOR_BITS)) < dataSize)
+            tableBits++;
+
+        table.assign(size_t(1) << tableBits, Entry{ 0, 0 });
+        hash = 0;
+        candidateFor = 0;
+        candidate = 0;
+    }
+
+    /*
+    * Учет очередного байта входа
+    * position - позиция сразу после byte (количество учтенных байтов),
+    * removed - байт, выходящий из хеша (position - HASH_LENGTH - 1), если position > HASH_LENGTH
+    */
+    void Update(unsigned char byte, unsigned char removed, uint64_t position)
+    {
+        hash = hash * PRIME + byte + 1;
+        if (position > HASH_LENGTH)
+            hash -= (static_cast<uint64_t>(removed) + 1) * removePower;
+
+        if (position < HASH_LENGTH || (hash >> (64 - ANCHOR_BITS)) != 0)
+            return;
+
+        // Якорь: запоминаем прежнего владельца записи как кандидата и занимаем запись
+        Entry& entry = table[(hash >> (64 - ANCHOR_BITS - tableBits)) & ((size_t(1) << tableBits) - 1)];
+        uint32_t check = static_cast<uint32_t>(hash);
+        if (entry.position != 0 && entry.check == check)
+        {
+            candidateFor = position;
+            candidate = entry.position;
+        }
+        entry.position = position;
+        entry.check = check;
+    }
+
+    // Кандидат для позиции position (0 - кандидата нет)
+    uint64_t GetCandidate(uint64_t position) const
+    {
+        return (candidateFor == position) ? candidate : 0;
+    }
+};
@@ -985,12 +985,20 @@ wstring archiveName;// Имя архива для распаковки
 
 // Переменные состояния:
 CompressAlg alg; // Выбранный алгоритм сжатия (перечисление)
+LZOptions lzOptions; // Параметры LZ77/LZH (уровень выбирается кнопкой)
 bool compressing = false; // Флаг, указывающий, что идет процесс сжатия
 bool decompressing = false;// Флаг, указывающий, что идет процесс распаковки
 
 int cnt = 0;
 
 
+//надпись кнопки уровня сжатия LZ77/LZH: номер уровня и способ разбора
+wstring LevelButtonText(int level)
+{
+    const wchar_t* parse = (level <= 3) ? L"жадный" : (level <= 6) ? L"ленивый" : L"оптимальный";
+    return L"Уровень LZ: " + to_wstring(level) + L" (" + parse + L")";
+}
+
 //функция для проверки нахождения курсора в данном прямоугольнике
 bool IsInRECT(RECT r, POINT mousePos)
 {
@@ -1095,6 +1103,12 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
         createBtn.SetColor(RGB(190, 190, 190), RGB(255, 255, 255), RGB(150, 150, 150));
         buttons.push_back(createBtn);
 
+        // Кнопка уровня сжатия LZ77/LZH - над радиокнопками, каждое нажатие выбирает следующий уровень
+        Button levelBtn{ "level" };
+        levelBtn.SetGeometry({ 310, 326 }, { 490, 350 }, LevelButtonText(lzOptions.level), 1);
+        levelBtn.SetColor(RGB(190, 190, 190), RGB(255, 255, 255), RGB(150, 150, 150));
+        buttons.push_back(levelBtn);
+
         // Создание текстовой метки "Сохранить архив как:" с помощью умного указателя
         auto saveLabel = make_shared<Text>("saveArchiveAs");
         saveLabel->SetFontHeight(15);
@@ -1114,6 +1128,11 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
         lz77RB->SetGeometry({ 310, 355 }, 15, L"LZ77");
         radioButtons.push_back(lz77RB);
 
+        // LZH - в той же строке, что и LZ77 (столбец радиокнопок заполнен до низа окна)
+        auto lzhRB = make_shared<RadioButton>("lzh");
+        lzhRB->SetGeometry({ 390, 355 }, 15, L"LZ77 + Хаффман (LZH)");
+        radioButtons.push_back(lzhRB);
+
         auto lz78RB = make_shared<RadioButton>("lz78");
         lz78RB->SetGeometry({ 310, lz77RB->GetBody().bottom + 4}, 15, L"LZ78");
         radioButtons.push_back(lz78RB);
@@ -1127,6 +1146,18 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
         adHuff->SetGeometry({ 310, stHuff->GetBody().bottom + 4 }, 15, L"Хаффман (адаптивный)");
         radioButtons.push_back(adHuff);
 
+        auto ilHuff = make_shared<RadioButton>("ilHuff");
+        ilHuff->SetGeometry({ 310, adHuff->GetBody().bottom + 4 }, 15, L"Хаффман (4 потока)");
+        radioButtons.push_back(ilHuff);
+
+        auto saHuff = make_shared<RadioButton>("saHuff");
+        saHuff->SetGeometry({ 310, ilHuff->GetBody().bottom + 4 }, 15, L"Хаффман (полуадаптивный)");
+        radioButtons.push_back(saHuff);
+
+        auto rangeRB = make_shared<RadioButton>("range");
+        rangeRB->SetGeometry({ 310, saHuff->GetBody().bottom + 4 }, 15, L"Интервальное кодирование");
+        radioButtons.push_back(rangeRB);
+
         // Создание стандартного текстового поля Windows для ввода пути сохранения архива
         saveArchiveAsTB = CreateWindow(
             TEXT("EDIT"), // Класс окна - поле ввода
@@ -1430,6 +1461,14 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
                     alg = CompressAlg::LZ77;
                 else if (radioButtons[i]->name == "lz78")
                     alg = CompressAlg::LZ78;
+                else if (radioButtons[i]->name == "ilHuff")
+                    alg = CompressAlg::InterleavedHuffman;
+                else if (radioButtons[i]->name == "saHuff")
+                    alg = CompressAlg::SemiAdaptiveHuffman;
+                else if (radioButtons[i]->name == "range")
+                    alg = CompressAlg::RangeCoder;
+                else if (radioButtons[i]->name == "lzh")
+                    alg = CompressAlg::LZH;
 
 
                 break; // Выходим после обработки клика
@@ -1486,6 +1525,14 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
                     RECT r = fileList.GetBody();
                     InvalidateRect(hWnd, &r, true);
                 }
+                else if (buttons[i].name == "level") // Кнопка уровня сжатия LZ77/LZH: следующий уровень, после 9 - снова 1
+                {
+                    lzOptions.level = (lzOptions.level >= LZ77::MAX_LEVEL) ? LZ77::MIN_LEVEL : lzOptions.level + 1;
+
+                    // Обновляем надпись, сохраняя размеры кнопки
+                    buttons[i].SetGeometry({ r.left, r.top }, { r.right, r.bottom }, LevelButtonText(lzOptions.level), 1);
+                    InvalidateRect(hWnd, &r, true);
+                }
                 else if (buttons[i].name == "selectArchivePath") // Кнопка "..." для выбора пути сохранения архива
                 {
                     // Открываем диалог выбора папки
@@ -1542,8 +1589,8 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
                     }
 
                     // Запускаем асинхронное создание архива
-                    // Использует выбранный алгоритм сжатия (alg)
-                    archiveManager.StartArchiveCreatingAsync(namesS, archivePathS, alg);
+                    // Использует выбранный алгоритм сжатия (alg) и параметры LZ77/LZH (lzOptions)
+                    archiveManager.StartArchiveCreatingAsync(namesS, archivePathS, alg, lzOptions);
 
                     // Активируем прогресс-бар
                     pg.SetState(true);
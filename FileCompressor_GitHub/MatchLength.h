@@ -0,0 +1,164 @@
+﻿#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MATCH_LENGTH_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#pragma once
+
+using namespace std;
+
+/*
+* Длина общего префикса двух участков памяти (продление совпадения в поиске LZ77)
+* Сравнение идет широкими словами, а первый отличающийся байт находится по маске различий:
+* - Scalar: 8 байт за раз - XOR двух слов и подсчет младших нулевых битов
+*   (в little-endian младший байт слова - первый в памяти);
+* - SSE2: 16 байт - сравнение байтов и movemask, затем подсчет нулей в маске;
+* - AVX2: 32 байта - то же на 256-битных регистрах.
+* Вариант выбирается один раз при первом вызове по возможностям процессора (cpuid).
+* Читается не больше limit байт с каждого адреса, поэтому запас в конце буфера не нужен.
+*/
+class MatchLength
+{
+    using Kernel = size_t(*)(const unsigned char*, const unsigned char*, size_t);
+
+    // Номер младшего единичного бита (value != 0)
+    static int CountTrailingZeros(uint64_t value)
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<int>(index);
+#elif defined(_MSC_VER)
+        unsigned long index;
+        if (_BitScanForward(&index, static_cast<unsigned long>(value)))
+            return static_cast<int>(index);
+        _BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+        return static_cast<int>(index) + 32;
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+
+    // Побайтное сравнение хвоста
+    static size_t Tail(const unsigned char* a, const unsigned char* b, size_t length, size_t limit)
+    {
+        while (length < limit && a[length] == b[length])
+            length++;
+        return length;
+    }
+
+    // Сравнение по 8 байт (продолжает с позиции length)
+    static size_t Words(const unsigned char* a, const unsigned char* b, size_t length, size_t limit)
+    {
+        while (length + 8 <= limit)
+        {
+            uint64_t wa;
+            uint64_t wb;
+            memcpy(&wa, a + length, 8);
+            memcpy(&wb, b + length, 8);
+
+            uint64_t diff = wa ^ wb;
+            if (diff != 0)
+                return length + (CountTrailingZeros(diff) >> 3);
+            length += 8;
+        }
+        return Tail(a, b, length, limit);
+    }
+
+    static size_t Scalar(const unsigned char* a, const unsigned char* b, size_t limit)
+    {
+        return Words(a, b, 0, limit);
+    }
+
+#ifdef MATCH_LENGTH_X86
+    static size_t SSE2(const unsigned char* a, const unsigned char* b, size_t limit)
+    {
+        size_t length = 0;
+        while (length + 16 <= limit)
+        {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + length));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + length));
+
+            // Единичный бит маски - несовпавший байт
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb))) ^ 0xFFFFu;
+            if (mask != 0)
+                return length + CountTrailingZeros(mask);
+            length += 16;
+        }
+        return Words(a, b, length, limit);
+    }
+
+#ifndef _MSC_VER
+    __attribute__((target("avx2")))
+#endif
+    static size_t AVX2(const unsigned char* a, const unsigned char* b, size_t limit)
+    {
+        size_t length = 0;
+        while (length + 32 <= limit)
+        {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + length));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + length));
+
+            uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb)));
+            if (mask != 0)
+                return length + CountTrailingZeros(mask);
+            length += 32;
+        }
+        return Words(a, b, length, limit);
+    }
+
+    // Поддержка AVX2 процессором и операционной системой (сохранение регистров YMM)
+    static bool HasAVX2()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+    static Kernel SelectKernel()
+    {
+#ifdef MATCH_LENGTH_X86
+        if (HasAVX2())
+            return AVX2;
+        return SSE2; // SSE2 есть на любом x86-64 (и обязателен для сборки x86 по умолчанию)
+#else
+        return Scalar;
+#endif
+    }
+
+public:
+    // Длина общего префикса a и b, не больше limit
+    static size_t Get(const unsigned char* a, const unsigned char* b, size_t limit)
+    {
+        static const Kernel kernel = SelectKernel();
+        return kernel(a, b, limit);
+    }
+
+    // Вариант без векторных инструкций (для сравнения и проверки)
+    static size_t GetScalar(const unsigned char* a, const unsigned char* b, size_t limit)
+    {
+        return Scalar(a, b, limit);
+    }
+};
@@ -0,0 +1,251 @@
+﻿#include <iostream>
+#include <fstream>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <atomic>
+#include <stdexcept>
+
+#pragma once
+
+using namespace std;
+
+/*Offset   Размер                Описание
+      0        8 байт                    Размер данных (dataSize) - количество исходных байтов
+      8        8 байт                    Размер сжатых данных (encodedSize) в байтах
+     16       переменный            Выход интервального кодера
+*/
+
+//Адаптивный интервальный (range) кодер нулевого порядка.
+//Байт кодируется как 8 двоичных решений (от старшего бита к младшему) по двоичному дереву
+//из 255 узлов: в каждом узле хранится вероятность нуля, которая после каждого бита
+//сдвигается к фактическому значению. Так модель подстраивается под данные за один проход,
+//а на символ тратится дробное число битов (в отличие от целых длин кодов Хаффмана).
+//Размер сжатых данных записан в заголовке, поэтому декодер читает ровно свою запись архива.
+
+class RangeCoder
+{
+    static constexpr int PROB_BITS = 11;                      // Разрядность вероятностей
+    static constexpr uint32_t PROB_INIT = 1 << (PROB_BITS - 1); // Начальная вероятность (1/2)
+    static constexpr int ADAPT_SHIFT = 5;                     // Скорость адаптации вероятностей
+    static constexpr uint32_t TOP = 1 << 24;                  // Граница нормализации интервала
+    static constexpr size_t BUFFER_SIZE = 1 << 16;            // Размер буферов ввода/вывода
+
+    array<uint16_t, 256> probs; // Вероятности нуля в узлах дерева (индексы 1-255)
+
+    // Состояние кодера
+    uint64_t low;
+    uint32_t range;
+    unsigned char cache;   // Байт, который еще может измениться из-за переноса
+    uint64_t cacheSize;    // Количество отложенных байтов (cache и следующие за ним 0xFF)
+    vector<unsigned char> outBuffer;
+    uint64_t written;      // Количество записанных байтов
+
+    // Состояние декодера
+    uint32_t code;
+    vector<unsigned char> inBuffer;
+    size_t inPos;
+    size_t inSize;
+    uint64_t unread;       // Сколько байтов записи еще не прочитано из файла
+
+    void ResetModel()
+    {
+        probs.fill(static_cast<uint16_t>(PROB_INIT));
+    }
+
+    // Запись байта в выходной буфер
+    void PutByte(ofstream& out, unsigned char b)
+    {
+        outBuffer.push_back(b);
+        written++;
+        if (outBuffer.size() == BUFFER_SIZE)
+        {
+            out.write(reinterpret_cast<const char*>(outBuffer.data()), outBuffer.size());
+            outBuffer.clear();
+        }
+    }
+
+    // Вывод старшего байта low с учетом переноса в уже отложенные байты
+    void ShiftLow(ofstream& out)
+    {
+        if (static_cast<uint32_t>(low) < 0xFF000000u || (low >> 32) != 0)
+        {
+            unsigned char carry = static_cast<unsigned char>(low >> 32);
+            unsigned char temp = cache;
+            do
+            {
+                PutByte(out, static_cast<unsigned char>(temp + carry));
+                temp = 0xFF;
+            } while (--cacheSize != 0);
+            cache = static_cast<unsigned char>(low >> 24);
+        }
+        cacheSize++;
+        low = (low & 0x00FFFFFF) << 8;
+    }
+
+    // Кодирование одного бита с вероятностью нуля prob
+    // Без условных переходов по значению бита: биты данных плохо предсказуемы,
+    // и ошибки предсказания стоили бы дороже самих вычислений
+    void EncodeBit(ofstream& out, uint16_t& prob, int bit)
+    {
+        uint32_t bound = (range >> PROB_BITS) * prob;
+        uint32_t mask = 0u - static_cast<uint32_t>(bit); // 0 для нуля, все единицы для единицы
+
+        low += bound & mask;
+        range = bound ^ ((bound ^ (range - bound)) & mask);
+        prob = static_cast<uint16_t>(prob + ((((1u << PROB_BITS) - prob) >> ADAPT_SHIFT) & ~mask) - ((prob >> ADAPT_SHIFT) & mask));
+
+        while (range < TOP)
+        {
+            range <<= 8;
+            ShiftLow(out);
+        }
+    }
+
+    // Чтение очередного байта сжатых данных
+    unsigned char GetByte(ifstream& in)
+    {
+        if (inPos == inSize)
+        {
+            if (unread == 0)
+                throw runtime_error("End of file");
+
+            size_t toRead = (unread < BUFFER_SIZE) ? static_cast<size_t>(unread) : BUFFER_SIZE;
+            in.read(reinterpret_cast<char*>(inBuffer.data()), toRead);
+            inSize = static_cast<size_t>(in.gcount());
+            inPos = 0;
+            if (inSize == 0)
+                throw runtime_error("End of file");
+            unread -= inSize;
+        }
+        return inBuffer[inPos++];
+    }
+
+    // Декодирование одного бита с вероятностью нуля prob (тоже без переходов по значению бита)
+    int DecodeBit(ifstream& in, uint16_t& prob)
+    {
+        uint32_t bound = (range >> PROB_BITS) * prob;
+        int bit = (code >= bound) ? 1 : 0;
+        uint32_t mask = 0u - static_cast<uint32_t>(bit);
+
+        code -= bound & mask;
+        range = bound ^ ((bound ^ (range - bound)) & mask);
+        prob = static_cast<uint16_t>(prob + ((((1u << PROB_BITS) - prob) >> ADAPT_SHIFT) & ~mask) - ((prob >> ADAPT_SHIFT) & mask));
+
+        while (range < TOP)
+        {
+            range <<= 8;
+            code = (code << 8) | GetByte(in);
+        }
+        return bit;
+    }
+
+public:
+    /*
+    * Метод кодирования файла (сжатие)
+    * Возвращает размер сжатых данных в байтах
+    */
+    uint64_t EncodeFile(ifstream& in, ofstream& out, atomic<uint64_t>& processedBytes)
+    {
+        ResetModel();
+        low = 0;
+        range = 0xFFFFFFFFu;
+        cache = 0;
+        cacheSize = 1;
+        written = 0;
+        outBuffer.clear();
+        outBuffer.reserve(BUFFER_SIZE);
+
+        // Запоминаем позицию и пишем заглушки для метаданных
+        streamsize beg = out.tellp();
+        uint64_t zeroSize = 0;
+        out.write(reinterpret_cast<const char*>(&zeroSize), 8); // Под размер данных
+        out.write(reinterpret_cast<const char*>(&zeroSize), 8); // Под размер сжатых данных
+
+        uint64_t dataSize = 0;
+        vector<unsigned char> block(BUFFER_SIZE);
+        while (true)
+        {
+            in.read(reinterpret_cast<char*>(block.data()), BUFFER_SIZE);
+            size_t blockSize = static_cast<size_t>(in.gcount());
+            if (blockSize == 0)
+                break; // Достигнут конец файла
+
+            for (size_t i = 0; i < blockSize; i++)
+            {
+                // Биты байта от старшего к младшему, узел дерева определяется уже закодированными битами
+                int node = 1;
+                for (int b = 7; b >= 0; b--)
+                {
+                    int bit = (block[i] >> b) & 1;
+                    EncodeBit(out, probs[node], bit);
+                    node = (node << 1) | bit;
+                }
+            }
+
+            dataSize += blockSize;
+            processedBytes.fetch_add(blockSize); // Обновляем прогресс
+        }
+
+        // Выталкиваем из кодера все оставшиеся байты
+        for (int i = 0; i < 5; i++)
+            ShiftLow(out);
+        out.write(reinterpret_cast<const char*>(outBuffer.data()), outBuffer.size());
+        outBuffer.clear();
+
+        // Возвращаемся и пишем реальные метаданные
+        streampos encodedDataEnd = out.tellp();
+        out.seekp(beg, std::ios::beg);
+        out.write(reinterpret_cast<char*>(&dataSize), 8);
+        out.write(reinterpret_cast<char*>(&written), 8);
+        out.seekp(encodedDataEnd);
+
+        return written;
+    }
+
+    /*
+    * Метод декодирования файла (распаковка)
+    */
+    void DecodeFile(ifstream& in, ofstream& out, atomic<uint64_t>& processedBytes)
+    {
+        ResetModel();
+
+        uint64_t dataSize = 0;
+        in.read(reinterpret_cast<char*>(&dataSize), 8);
+        uint64_t encodedSize = 0;
+        in.read(reinterpret_cast<char*>(&encodedSize), 8);
+
+        inBuffer.resize(BUFFER_SIZE);
+        inPos = inSize = 0;
+        unread = encodedSize;
+
+        // Начальное состояние: первые 5 байтов (первый всегда 0 - начальный cache кодера)
+        range = 0xFFFFFFFFu;
+        code = 0;
+        for (int i = 0; i < 5; i++)
+            code = (code << 8) | GetByte(in);
+
+        vector<unsigned char> block(BUFFER_SIZE);
+        uint64_t remaining = dataSize;
+        while (remaining > 0)
+        {
+            size_t blockSize = (remaining < BUFFER_SIZE) ? static_cast<size_t>(remaining) : BUFFER_SIZE;
+
+            for (size_t i = 0; i < blockSize; i++)
+            {
+                int node = 1;
+                while (node < 256)
+                    node = (node << 1) | DecodeBit(in, probs[node]);
+                block[i] = static_cast<unsigned char>(node - 256);
+            }
+
+            out.write(reinterpret_cast<const char*>(block.data()), blockSize);
+            processedBytes.fetch_add(blockSize); // Обновляем прогресс
+            remaining -= blockSize;
+        }
+
+        // Пропускаем непрочитанный остаток записи (если он есть), чтобы встать на следующую
+        if (unread > 0)
+            in.seekg(static_cast<streamoff>(unread), std::ios::cur);
+    }
+};
@@ -0,0 +1,205 @@
+﻿#include <iostream>
+#include <fstream>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <atomic>
+#include "FileRW.h"
+#include "StaticHuffman.h"
+
+#pragma once
+
+using namespace std;
+
+/*Offset   Размер                Описание
+      0        8 байт                    Размер данных (dataSize) - количество исходных байтов
+      8        1 байт                     Дополнение (padding) - количество битов дополнения в конце
+      9        переменный            Закодированные данные (битовый поток)
+*/
+
+//Полуадаптивный Хаффман: таблица кодов в файл не пишется. Кодер и декодер одинаково
+//считают частоты уже обработанных байтов и перестраивают канонические коды каждые
+//rebuildInterval символов. Между перестроениями коды не меняются, поэтому декодер
+//работает по таблицам (как статический Хаффман), а не идет по дереву бит за битом.
+//Интервал начинается с INITIAL_INTERVAL и удваивается до MAX_INTERVAL: в начале файла
+//коды быстро подстраиваются под данные, дальше перестроения становятся редкими.
+
+class SemiAdaptiveHuffmanCoder
+{
+    // Первый интервал перестроения таблицы и его предел (в символах)
+    // Короткий предел нужен, чтобы байт, ставший частым, быстро получал короткий код
+    static constexpr uint64_t INITIAL_INTERVAL = 256;
+    static constexpr uint64_t MAX_INTERVAL = 1 << 10;
+    // При достижении этой суммы частот все частоты делятся пополам (старая статистика "забывается"):
+    // модель отражает последние несколько тысяч символов и следит за сменой распределения
+    static constexpr uint64_t RESCALE_LIMIT = 1 << 12;
+    // Ограничение длины кода: коды почти всегда разрешаются первичной таблицей декодера
+    static constexpr int CODE_LENGTH_LIMIT = 12;
+    // Размер блока чтения/записи и обновления прогресса
+    static constexpr size_t BLOCK_SIZE = 1 << 16;
+
+    array<uint64_t, 256> counts;            // Частоты обработанных байтов (не меньше 1)
+    uint64_t totalCount;                    // Сумма частот
+    array<unsigned char, 256> codeLengths;  // Длины кодов текущей таблицы
+    array<uint64_t, 256> codes;             // Канонические коды текущей таблицы
+    uint64_t rebuildInterval;               // Текущий интервал перестроения
+    uint64_t untilRebuild;                  // Символов до следующего перестроения
+
+    // Начальное состояние модели: все байты равновероятны (коды по 8 бит)
+    void Reset()
+    {
+        counts.fill(1);
+        totalCount = 256;
+        rebuildInterval = INITIAL_INTERVAL;
+        untilRebuild = rebuildInterval;
+        MakeLengths();
+    }
+
+    // Построение длин и канонических кодов по текущим частотам
+    void MakeLengths()
+    {
+        StaticHuffmanManager::BuildCodeLengths(counts.data(), 256, CODE_LENGTH_LIMIT, codeLengths.data());
+        StaticHuffmanManager::MakeCanonicalCodes(codeLengths.data(), 256, codes.data());
+    }
+
+    // Учет закодированного байта; возвращает true, если таблицу пора перестроить
+    bool Update(unsigned char byte)
+    {
+        counts[byte]++;
+        totalCount++;
+        return --untilRebuild == 0;
+    }
+
+    // Перестроение таблицы (одинаково в кодере и декодере)
+    void Rebuild()
+    {
+        // Масштабирование частот: каждая частота остается не меньше 1, чтобы у любого байта был код
+        if (totalCount >= RESCALE_LIMIT)
+        {
+            totalCount = 0;
+            for (int i = 0; i < 256; i++)
+            {
+                counts[i] = (counts[i] + 1) / 2;
+                totalCount += counts[i];
+            }
+        }
+
+        MakeLengths();
+
+        rebuildInterval = (rebuildInterval * 2 < MAX_INTERVAL) ? rebuildInterval * 2 : MAX_INTERVAL;
+        untilRebuild = rebuildInterval;
+    }
+
+public:
+    SemiAdaptiveHuffmanCoder() { Reset(); }
+
+    /*
+    * Метод кодирования файла (сжатие)
+    * Файл читается один раз; размер данных и дополнение дописываются в заголовок в конце
+    * Возвращает размер сжатых данных в байтах
+    */
+    uint64_t EncodeFile(ifstream& in, ofstream& out, atomic<uint64_t>& processedBytes)
+    {
+        Reset();
+
+        // Запоминаем позицию для записи метаданных
+        streamsize beg = out.tellp();
+
+        //пишем заглушки для метаданных
+        uint64_t zeroSize = 0;
+        unsigned char zeroByte = 0;
+        out.write(reinterpret_cast<const char*>(&zeroSize), 8); // Под размер данных
+        out.write(reinterpret_cast<const char*>(&zeroByte), 1); // Под дополнение
+
+        BitWriter writer{ out };
+        uint64_t compressedSize = 0; // Размер сжатых данных в битах
+        uint64_t dataSize = 0; // Количество исходных байтов
+
+        vector<unsigned char> block(BLOCK_SIZE);
+        while (true)
+        {
+            in.read(reinterpret_cast<char*>(block.data()), BLOCK_SIZE);
+            size_t blockSize = static_cast<size_t>(in.gcount());
+            if (blockSize == 0)
+                break; // Достигнут конец файла
+
+            for (size_t i = 0; i < blockSize; i++)
+            {
+                unsigned char byte = block[i];
+                writer.WriteBits(codes[byte], codeLengths[byte]);
+                compressedSize += codeLengths[byte];
+
+                if (Update(byte))
+                    Rebuild();
+            }
+
+            dataSize += blockSize;
+            processedBytes.fetch_add(blockSize); // Обновляем прогресс
+        }
+
+        // Записываем оставшиеся биты из буфера
+        writer.FlushFileBuffer();
+        unsigned char padding = writer.GetPaddingBits();
+
+        // Возвращаемся к началу записи, чтобы записать реальные метаданные
+        streampos encodedDataEnd = out.tellp();
+        out.seekp(beg, std::ios::beg);
+        out.write(reinterpret_cast<char*>(&dataSize), 8);
+        out.write(reinterpret_cast<char*>(&padding), 1);
+        out.seekp(encodedDataEnd);
+
+        return (compressedSize + static_cast<uint64_t>(padding)) / 8;
+    }
+
+    /*
+    * Метод декодирования файла (распаковка)
+    * Таблицы декодирования перестраиваются в те же моменты, что и таблица кодера
+    */
+    void DecodeFile(ifstream& in, ofstream& out, atomic<uint64_t>& processedBytes)
+    {
+        Reset();
+
+        // Шаг 1: Чтение метаданных
+        uint64_t dataSize = 0;
+        in.read(reinterpret_cast<char*>(&dataSize), 8);
+
+        unsigned char padding = 0;
+        in.read(reinterpret_cast<char*>(&padding), 1);
+
+        BitReader reader{ in };
+
+        StaticHuffmanManager::DecodeTable decodeTable;
+        decodeTable.Build(codeLengths.data(), 256);
+
+        // Шаг 2: Декодирование блоками
+        vector<unsigned char> block(BLOCK_SIZE);
+        uint64_t remaining = dataSize;
+        while (remaining > 0)
+        {
+            size_t blockSize = (remaining < BLOCK_SIZE) ? static_cast<size_t>(remaining) : BLOCK_SIZE;
+
+            for (size_t i = 0; i < blockSize; i++)
+            {
+                unsigned char byte = static_cast<unsigned char>(decodeTable.Decode(reader));
+                block[i] = byte;
+
+                if (Update(byte))
+                {
+                    Rebuild();
+                    decodeTable.Build(codeLengths.data(), 256);
+                }
+            }
+
+            out.write(reinterpret_cast<const char*>(block.data()), blockSize);
+            processedBytes.fetch_add(blockSize); // Обновляем прогресс
+            remaining -= blockSize;
+        }
+
+        // Шаг 3: Пропускаем биты дополнения (выравнивание до байта)
+        for (int i = 0; i < padding; i++)
+            reader.ReadBit();
+
+        // Возвращаем в архив байты, прочитанные читателем наперед
+        reader.SyncStream();
+    }
+};
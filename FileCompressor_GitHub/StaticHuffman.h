@@ -1,108 +1,110 @@
 ﻿#include <iostream>
 #include <fstream>
 #include <vector>
-#include <map>
-#include <list>
-#include <memory>
 #include <array>
-#include <bitset>
+#include <utility>
 #include <cstdint>
 #include "FileRW.h"
+#include "Histogram.h"
 #include <atomic>
+#include <algorithm>
 
 #pragma once
 
 using namespace std;
 
-/*Offset   Размер                Описание
-      0        2 байта                  Размер таблицы (tableSize) - количество уникальных символов (1-256)
-      2        8 байт                    Размер данных (dataSize) - количество исходных байтов
-     10       1 байт                     Дополнение (padding) - количество битов дополнения в конце
-     11       переменный          Таблица кодов
-     ...       переменный            Закодированные данные (битовый поток)
+//Файл кодируется независимыми блоками: для каждого блока строится своя таблица кодов,
+//поэтому входной файл читается один раз, а память ограничена размером блока.
+//Формат блока (все поля пишутся битовым потоком, старшие биты первыми):
+/*[Размер блока]   : 4 байта (uint32_t) - количество исходных байтов в блоке (0 - конец данных)
+[Размер таблицы] : 2 байта (uint16_t) - количество уникальных символов блока (1-256)
+[Таблица кодов]  : переменный размер
+[Закодированные данные] : битовый поток, дополненный нулями до границы байта
 */
+//За последним блоком следует признак конца - блок нулевого размера (4 нулевых байта).
 
-//Каждая запись таблицы (повторяется tableSize раз):
+//Коды Хаффмана канонические, поэтому в таблице хранятся только длины кодов.
+//Если tableSize < SPARSE_TABLE_LIMIT, таблица разреженная (повторяется tableSize раз):
 /*[Символ]      : 1 байт  (unsigned char) - исходный символ
-[Длина кода]  : 1 байт  (unsigned char) - длина кода Хаффмана в битах (1-255)
-[Код]         : N бит   - сам код Хаффмана (N = длина кода)
+[Длина кода]  : 1 байт  (unsigned char) - длина кода Хаффмана в битах
 */
+//Иначе таблица полная: 256 байт - длина кода для каждого символа 0-255 (0 = символ не встречается)
 
 class StaticHuffmanManager
 {
 
-    // Структура узла дерева Хаффмана
-    struct Node
+    // Длины кодов Хаффмана для каждого символа (0 - символ не встречается)
+    array<unsigned char, 256> codeLengths;
+    // Канонические коды Хаффмана для каждого символа (младшие codeLengths[i] бит)
+    array<uint64_t, 256> codes;
+    // Упакованная таблица кодировщика: (код << 8) | длина, для кодов не длиннее PACKED_CODE_LIMIT бит
+    array<uint32_t, 256> packedCodes;
+    // Длина самого длинного кода в текущей таблице
+    int maxCodeLength = 0;
+    // Ограничение длины кода при построении таблицы (настраивается в конструкторе)
+    int codeLengthLimit;
+
+    // Предел длины кода для упакованной таблицы
+    static constexpr int PACKED_CODE_LIMIT = 24;
+    // Размер блока (количество исходных байтов под одну таблицу кодов)
+    size_t blockSize;
+
+    // Заполнение упакованной таблицы кодировщика по codes и codeLengths
+    void makePackedCodes()
     {
-        unsigned char byte; // Символ (только для листьев)
-        int frequency; // Частота символа/сумма частот поддерева
-        shared_ptr<Node> left;  // Левый потомок (бит 0)
-        shared_ptr<Node> right; // Правый потомок (бит 1)
-
-        // Конструктор для листового узла (символ + частота)
-        Node(unsigned char byte, int freq) : byte{ byte }, frequency{ freq }, left(nullptr), right{ nullptr } {}
-
-        // Конструктор для внутреннего узла (объединяет два поддерева)
-        Node(shared_ptr<Node> l, shared_ptr<Node> r)
-            : byte(0), frequency(l->frequency + r->frequency), left(l), right(r)
-        {
-        }
-
-        // Проверка, является ли узел листом (нет потомков)
-        bool isLeaf() const
-        {
-            return !left && !right;
-        }
-    };
-
-    // Функтор для сравнения узлов при построении дерева Хаффмана
-    // Узлы сортируются по возрастанию частоты (меньшая частота -> выше приоритет)
-    struct MyCompare
-    {
-        bool operator()(const shared_ptr<Node> a, const shared_ptr<Node> b) const
+        maxCodeLength = 0;
+        for (int i = 0; i < 256; i++)
         {
-            return a->frequency < b->frequency;
+            maxCodeLength = (codeLengths[i] > maxCodeLength) ? codeLengths[i] : maxCodeLength;
+            packedCodes[i] = (codeLengths[i] <= PACKED_CODE_LIMIT)
+                ? (static_cast<uint32_t>(codes[i]) << 8) | codeLengths[i]
+                : 0;
         }
-    };
-
-    // Временный вектор для построения кодов (путь от корня до текущего узла)
-    vector<bool> code;
-    // Таблица кодов Хаффмана: символ -> его двоичный код (вектор битов)
-    map<unsigned char, vector<bool>> table;
+    }
 
-    // Рекурсивное построение таблицы кодов Хаффмана (обход дерева в глубину)
-    void makeTable(shared_ptr<Node> root)
+    /*
+    * Кодирование блока байтов по текущей таблице
+    * Если коды не длиннее 16 бит, четыре символа собираются в одно значение
+    * (не больше 64 бит) и пишутся одним вызовом WriteBits.
+    * Возвращает количество записанных битов.
+    */
+    uint64_t encodeBlock(const unsigned char* data, size_t size, BitWriter& writer)
     {
-        // Если дерево состоит из одного узла (один символ в файле)
-        if (root->isLeaf())
-        {
-            code.push_back(0);  // добавляем фиктивный бит 0
-            table[root->byte] = code; // сохраняем код для символа
-            code.pop_back(); // удаляем фиктивный бит
-            return;
-        }
+        uint64_t bits = 0;
+        size_t i = 0;
 
-        // Рекурсивный обход левого поддерева (добавляем бит 0)
-        if (root->left != nullptr)
+        if (maxCodeLength <= 16)
         {
-            code.push_back(0);
-            makeTable(root->left);
-            code.pop_back(); // Возвращаемся назад
+            for (; i + 4 <= size; i += 4)
+            {
+                uint32_t e0 = packedCodes[data[i]];
+                uint32_t e1 = packedCodes[data[i + 1]];
+                uint32_t e2 = packedCodes[data[i + 2]];
+                uint32_t e3 = packedCodes[data[i + 3]];
+
+                int l1 = e1 & 0xFF;
+                int l2 = e2 & 0xFF;
+                int l3 = e3 & 0xFF;
+                int total = (e0 & 0xFF) + l1 + l2 + l3;
+
+                uint64_t value = e0 >> 8;
+                value = (value << l1) | (e1 >> 8);
+                value = (value << l2) | (e2 >> 8);
+                value = (value << l3) | (e3 >> 8);
+
+                writer.WriteBits(value, total);
+                bits += total;
+            }
         }
 
-        // Рекурсивный обход правого поддерева (добавляем бит 1)
-        if (root->right != nullptr)
+        // Оставшиеся символы (или все, если есть длинные коды) пишутся по одному
+        for (; i < size; i++)
         {
-            code.push_back(1);
-            makeTable(root->right);
-            code.pop_back(); // Возвращаемся назад
+            writer.WriteBits(codes[data[i]], codeLengths[data[i]]);
+            bits += codeLengths[data[i]];
         }
 
-        // Сохраняем код для листового узла
-        if (root->isLeaf())
-        {
-            table[root->byte] = code;
-        }
+        return bits;
     }
 
     // Вспомогательная функция для записи uint64_t в big-endian формате
@@ -118,253 +120,590 @@ class StaticHuffmanManager
         out.write(reinterpret_cast<const char*>(bytes), 8);
     }
 public:
+    // Граница, ниже которой таблица длин пишется в разреженном виде (пары символ + длина)
+    static constexpr int SPARSE_TABLE_LIMIT = 128;
+    // Максимальная длина кода, при которой код помещается в uint64_t
+    static constexpr int MAX_CODE_LENGTH = 64;
+    // Ограничение длины кода по умолчанию: коды не длиннее первичной таблицы декодера + 1 бит
+    static constexpr int DEFAULT_CODE_LENGTH_LIMIT = 12;
+    // Допустимый диапазон ограничения: 8 бит нужно для 256 символов,
+    // больше PACKED_CODE_LIMIT не помещается в упакованную таблицу кодировщика
+    static constexpr int MIN_CODE_LENGTH_LIMIT = 8;
+    static constexpr int MAX_CODE_LENGTH_LIMIT = PACKED_CODE_LIMIT;
+    // Размер блока по умолчанию и допустимый диапазон
+    // (маленькие блоки хуже из-за таблиц, большие - медленнее подстраиваются под данные)
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+    static constexpr size_t MIN_BLOCK_SIZE = 1 << 17;
+    static constexpr size_t MAX_BLOCK_SIZE = 1 << 24;
+
+    StaticHuffmanManager(int codeLengthLimit = DEFAULT_CODE_LENGTH_LIMIT, size_t blockSize = DEFAULT_BLOCK_SIZE)
+        : codeLengthLimit{ (codeLengthLimit < MIN_CODE_LENGTH_LIMIT) ? MIN_CODE_LENGTH_LIMIT
+            : (codeLengthLimit > MAX_CODE_LENGTH_LIMIT) ? MAX_CODE_LENGTH_LIMIT : codeLengthLimit },
+        blockSize{ (blockSize < MIN_BLOCK_SIZE) ? MIN_BLOCK_SIZE
+            : (blockSize > MAX_BLOCK_SIZE) ? MAX_BLOCK_SIZE : blockSize }
+    {
+    }
+
     /*
-    * Метод кодирования файла (сжатие)
-    * Формат выходных данных:
-    * [Размер таблицы]  : 2 байта (uint16_t) - количество записей в таблице (1-256)
-    * [Размер данных]   : 8 байт (uint64_t) - количество исходных байтов
-    * [Дополнение]      : 1 байт (uint8_t) - количество битов дополнения в конце
-    * [Таблица кодов]   : переменный размер
-    * [Закодированные данные] : битовый поток
+    * Построение длин кодов Хаффмана по частотам символов (метод двух очередей)
+    * Листья один раз сортируются по возрастанию частоты и образуют первую очередь.
+    * Внутренние узлы создаются в порядке неубывания веса, поэтому сами образуют
+    * вторую отсортированную очередь: два минимальных узла всегда лежат в головах очередей.
+    * Дерево хранится в плоских массивах (вес и индекс родителя), без выделения узлов в куче.
+    * Построение - O(n log n) на сортировку и O(n) на слияния.
+    * Если дерево глубже limit бит, длины перестраиваются через LimitCodeLengths.
     */
-    uint64_t EncodeFile(ifstream& in, ofstream& out, atomic<uint64_t>& processedBytes)
+    static void BuildCodeLengths(const uint64_t* freq, int symbolCount, int limit, unsigned char* lengths)
     {
-        // Очищаем предыдущее состояние
-        code.clear();
-        table.clear();
-
-        uint64_t compressedSize = 0; // Размер сжатых данных в битах
+        // Символы с ненулевой частотой в порядке возрастания частоты
+        vector<int> symbols;
+        for (int i = 0; i < symbolCount; i++)
+        {
+            lengths[i] = 0;
+            if (freq[i] != 0)
+                symbols.push_back(i);
+        }
+        stable_sort(symbols.begin(), symbols.end(), [freq](int a, int b) { return freq[a] < freq[b]; });
 
-        // пишем таблицу кодов
-        array<int, 256> byteFreq = { 0 }; // Массив частот для всех 256 возможных байтов
-        
-        //читаем весь файл и увеличиваем частоту для каждого очередной раз встретившегося байта 
-        unsigned char byte;
-        while (in.read(reinterpret_cast<char*>(&byte), 1))
+        int n = static_cast<int>(symbols.size());
+        if (n == 0)
+            return;
+        if (n == 1)
         {
-            byteFreq[byte]++; // Инкрементируем счетчик для этого байта
+            // Один символ в файле - код имеет длину 1
+            lengths[symbols[0]] = 1;
+            return;
         }
 
-        //Построение начального списка узлов (листьев)
-        list<shared_ptr<Node>> nodes; // Список узлов для построения дерева
-        MyCompare huffmanComparator; // Компаратор для сортировки
+        // Узлы 0..n-1 - листья (в порядке symbols), n..2n-2 - внутренние узлы, 2n-2 - корень
+        vector<uint64_t> weight(2 * n - 1);
+        vector<int> parent(2 * n - 1);
+        for (int i = 0; i < n; i++)
+            weight[i] = freq[symbols[i]];
 
-        // Создаем листовые узлы только для символов с ненулевой частотой
-        for (int i = 0; i < 256; i++)
+        int leaf = 0;     // Голова очереди листьев
+        int internal = n; // Голова очереди внутренних узлов
+        for (int next = n; next < 2 * n - 1; next++)
         {
-            if (byteFreq[i] > 0)
+            // Два узла с наименьшим весом из голов очередей (при равенстве - лист)
+            int son[2];
+            for (int k = 0; k < 2; k++)
             {
-                nodes.push_back(make_shared<Node>(static_cast<unsigned char>(i), byteFreq[i]));
+                if (leaf < n && (internal >= next || weight[leaf] <= weight[internal]))
+                    son[k] = leaf++;
+                else
+                    son[k] = internal++;
             }
+
+            weight[next] = weight[son[0]] + weight[son[1]];
+            parent[son[0]] = next;
+            parent[son[1]] = next;
         }
 
-        //Построение дерева Хаффмана (алгоритм слияния узлов)
-        while (nodes.size() != 1) // Пока не останется один корневой узел
+        // Глубины узлов: родитель всегда создан позже потомка, поэтому идем от корня вниз
+        vector<int> depth(2 * n - 1);
+        depth[2 * n - 2] = 0;
+        int maxDepth = 0;
+        for (int i = 2 * n - 3; i >= 0; i--)
         {
-            // Сортируем узлы по возрастанию частоты
-            nodes.sort(huffmanComparator);
-
-            // Берем два узла с наименьшей частотой
-            shared_ptr<Node> sonL = nodes.front();
-            nodes.pop_front();
-            shared_ptr<Node> sonR = nodes.front();
-            nodes.pop_front();
-
-            // Создаем родительский узел
-            shared_ptr<Node> parent = make_shared<Node>(sonL, sonR);
-            nodes.push_back(parent);
+            depth[i] = depth[parent[i]] + 1;
+            maxDepth = (i < n && depth[i] > maxDepth) ? depth[i] : maxDepth;
         }
 
-        //Построение таблицы кодов Хаффмана (обход дерева)
-        makeTable(nodes.back()); // nodes.back() - корневой узел
+        // Если дерево оказалось глубже ограничения, строим оптимальные длины с ограничением
+        if (maxDepth > limit)
+        {
+            LimitCodeLengths(freq, symbolCount, limit, lengths);
+            return;
+        }
 
-        // Переоткрываем файл для кодирования
-        in.clear();
-        in.seekg(0, std::ios::beg); // Возвращаемся в начало файла
+        for (int i = 0; i < n; i++)
+            lengths[symbols[i]] = static_cast<unsigned char>(depth[i]);
+    }
 
+    /*
+    * Построение длин кодов с ограничением максимальной длины (алгоритм package-merge)
+    * Символы с ненулевой частотой упорядочиваются по возрастанию частоты - это список листьев.
+    * limit - 1 раз из текущего списка попарно собираются "пакеты" (сумма весов двух соседних
+    * элементов), которые сливаются со списком листьев. Из последнего списка берутся первые
+    * 2n - 2 элемента; длина кода символа равна числу выбранных элементов, в которые он входит.
+    * Результат - оптимальные длины среди всех кодов не длиннее limit бит.
+    */
+    static void LimitCodeLengths(const uint64_t* freq, int symbolCount, int limit, unsigned char* lengths)
+    {
+        // Символы с ненулевой частотой в порядке возрастания частоты
+        vector<int> symbols;
+        for (int i = 0; i < symbolCount; i++)
+        {
+            lengths[i] = 0;
+            if (freq[i] != 0)
+                symbols.push_back(i);
+        }
+        stable_sort(symbols.begin(), symbols.end(), [freq](int a, int b) { return freq[a] < freq[b]; });
 
-        unsigned char zeroByte = 0; // Для временных заглушек
+        int n = static_cast<int>(symbols.size());
+        if (n == 0)
+            return;
+        if (n == 1)
+        {
+            lengths[symbols[0]] = 1;
+            return;
+        }
+        if (limit >= 31 || (1 << limit) < n)
+            throw runtime_error("Invalid Huffman code length limit");
 
-        uint16_t tableSize = table.size(); // Количество уникальных символов
+        // Элемент списка: лист (symbol >= 0) или пакет из элементов child и child + 1 предыдущего списка
+        struct Item
+        {
+            uint64_t weight;
+            int symbol;
+            int child;
+        };
 
-        // Запоминаем позицию для записи метаданных
-        streamsize beg = out.tellp();
+        size_t maxItems = static_cast<size_t>(2 * n - 2); // Больше элементов из списка никогда не берется
+        vector<vector<Item>> levels(limit);
 
-        //размер таблицы
-        out.write(reinterpret_cast<char*>(&tableSize), 2);
+        // Список листьев
+        for (int i = 0; i < n && levels[0].size() < maxItems; i++)
+            levels[0].push_back(Item{ freq[symbols[i]], i, -1 });
 
-        // пишем заглушки для метаданных
-        //размер данных
-        out.write(reinterpret_cast<char*>(&zeroByte), 8);
+        for (int level = 1; level < limit; level++)
+        {
+            const vector<Item>& previous = levels[level - 1];
+            vector<Item>& current = levels[level];
 
-        //padding данных
-        out.write(reinterpret_cast<char*>(&zeroByte), 1);
+            // Слияние листьев с пакетами из пар предыдущего списка (при равных весах лист идет первым)
+            int leaf = 0;
+            size_t package = 0;
+            while (current.size() < maxItems)
+            {
+                bool hasLeaf = leaf < n;
+                bool hasPackage = package + 1 < previous.size();
+                if (!hasLeaf && !hasPackage)
+                    break;
 
+                uint64_t packageWeight = hasPackage ? previous[package].weight + previous[package + 1].weight : 0;
+                if (hasLeaf && (!hasPackage || freq[symbols[leaf]] <= packageWeight))
+                {
+                    current.push_back(Item{ freq[symbols[leaf]], leaf, -1 });
+                    leaf++;
+                }
+                else
+                {
+                    current.push_back(Item{ packageWeight, -1, static_cast<int>(package) });
+                    package += 2;
+                }
+            }
+        }
 
-        BitWriter writer{ out };
+        // Подсчет вхождений листьев в выбранные элементы (пакеты раскрываются до листьев)
+        vector<pair<int, int>> stack; // (уровень, индекс элемента)
+        for (size_t i = 0; i < maxItems; i++)
+            stack.push_back(make_pair(limit - 1, static_cast<int>(i)));
 
-         //Запись таблицы кодов в файл
-         // Формат каждой записи таблицы:
-         // [Символ] (1 байт) + [Длина кода] (1 байт) + [Код] (переменная длина)
-        for (const auto& pair : table)
+        while (!stack.empty())
         {
-            unsigned char encodedByte = pair.first;  // Символ
-            vector<bool> code = pair.second; // Код Хаффмана
-
-            unsigned char c = code.size(); // Длина кода (1-255)
-            writer.WriteByte(encodedByte); //пишем сам байт
-            writer.WriteByte(c); //пишем длину присвоенного ему кода
+            pair<int, int> top = stack.back();
+            stack.pop_back();
 
-            for (bool bit : code)
+            const Item& item = levels[top.first][top.second];
+            if (item.symbol >= 0)
             {
-                writer.WriteBit(bit); //пишем сам код
+                lengths[symbols[item.symbol]]++;
+            }
+            else
+            {
+                stack.push_back(make_pair(top.first - 1, item.child));
+                stack.push_back(make_pair(top.first - 1, item.child + 1));
             }
         }
+    }
 
-        //Создание lookup-таблицы для быстрого доступа к кодам
-        vector<vector<bool>> lookupTable(256); // Индекс = символ, значение = код
-        for (const auto& pair : table)
+    /*
+    * Назначение канонических кодов Хаффмана по длинам
+    * Символы упорядочиваются по (длина кода, значение символа),
+    * коды одной длины идут подряд, а при переходе к большей длине код сдвигается влево.
+    * Декодеру для восстановления кодов достаточно знать только длины.
+    */
+    static void MakeCanonicalCodes(const unsigned char* lengths, int symbolCount, uint64_t* codes)
+    {
+        // Количество кодов каждой длины
+        array<uint64_t, MAX_CODE_LENGTH + 1> lengthCount = { 0 };
+        for (int i = 0; i < symbolCount; i++)
         {
-            lookupTable[static_cast<unsigned char>(pair.first)] = pair.second;
+            if (lengths[i] > MAX_CODE_LENGTH)
+                throw runtime_error("Huffman code is too long");
+            lengthCount[lengths[i]]++;
         }
+        lengthCount[0] = 0;
 
-        //Кодирование данных (второй проход по файлу)
-        uint64_t dataSize = 0; // Счетчик исходных байтов
+        // Первый код каждой длины
+        array<uint64_t, MAX_CODE_LENGTH + 1> nextCode = { 0 };
+        uint64_t code = 0;
+        for (int len = 1; len <= MAX_CODE_LENGTH; len++)
+        {
+            code = (code + lengthCount[len - 1]) << 1;
+            nextCode[len] = code;
+        }
 
-        BitReader reader{ in };
+        // Раздаем коды символам в порядке возрастания их значений
+        for (int i = 0; i < symbolCount; i++)
+        {
+            codes[i] = (lengths[i] != 0) ? nextCode[lengths[i]]++ : 0;
+        }
+    }
 
-        while (true)
+    /*
+    * Табличный декодер канонических кодов Хаффмана
+    * Строится только по длинам кодов. Первичная таблица индексируется следующими
+    * LOOKUP_BITS битами потока и сразу дает символ и длину его кода.
+    * Коды длиннее LOOKUP_BITS разрешаются второй пробой во вторичной таблице своего префикса.
+    * Коды длиннее LOOKUP_BITS + MAX_SUB_BITS (возможны только при вырожденных частотах)
+    * декодируются побитно по каноническим диапазонам.
+    */
+    class DecodeTable
+    {
+    public:
+        static constexpr int LOOKUP_BITS = 11; // Разрядность первичной таблицы
+        static constexpr int MAX_SUB_BITS = 12; // Максимальная разрядность вторичной таблицы
+
+    private:
+        static constexpr uint16_t SLOW_PATH = 0xFFFF; // Признак побитного декодирования в subBits
+
+        // Элемент таблицы:
+        // subBits == 0 - value хранит символ, length - длину кода (0 - такого кода нет)
+        // subBits != 0 - value хранит смещение вторичной таблицы с разрядностью subBits
+        struct Entry
         {
-            try
+            uint32_t value;
+            uint16_t length;
+            uint16_t subBits;
+        };
+
+        vector<Entry> table; // Первичная таблица, за ней подряд все вторичные
+        int tableBits = 1; // Фактическая разрядность первичной таблицы
+
+        // Данные для побитного канонического декодирования
+        array<uint64_t, MAX_CODE_LENGTH + 1> firstCode = { 0 };
+        array<uint64_t, MAX_CODE_LENGTH + 1> lengthCount = { 0 };
+        array<int, MAX_CODE_LENGTH + 1> firstSymbol = { 0 };
+        vector<uint16_t> sortedSymbols; // Символы, упорядоченные по (длина кода, значение символа)
+        int maxLength = 0;
+
+        // Побитное декодирование по каноническим диапазонам кодов
+        template <class Reader>
+        uint16_t DecodeSlow(Reader& reader)
+        {
+            uint64_t current = 0;
+            int len = 0;
+            do
             {
-                byte = reader.ReadByte(); // Читаем очередной байт
+                if (++len > maxLength)
+                    throw runtime_error("Invalid Huffman code");
+
+                current = (current << 1) | (reader.ReadBit() ? 1 : 0);
+            } while (current - firstCode[len] >= lengthCount[len]);
+
+            return sortedSymbols[firstSymbol[len] + (current - firstCode[len])];
+        }
+
+    public:
+        // Построение таблиц по длинам кодов symbolCount символов
+        void Build(const unsigned char* lengths, int symbolCount)
+        {
+            // Канонические диапазоны для побитного декодирования
+            lengthCount.fill(0);
+            maxLength = 0;
+            for (int i = 0; i < symbolCount; i++)
+            {
+                if (lengths[i] > MAX_CODE_LENGTH)
+                    throw runtime_error("Huffman code is too long");
+                if (lengths[i] != 0)
+                {
+                    lengthCount[lengths[i]]++;
+                    maxLength = (lengths[i] > maxLength) ? lengths[i] : maxLength;
+                }
             }
-            catch (const exception& e)
+
+            /*
+           * Длины читаются из заголовка, поэтому проверяем неравенство Крафта до заполнения таблиц:
+           * при переполненном пространстве кодов коды вышли бы за пределы таблиц.
+           * Неполный набор допустим только из одного кода (блок из одного символа) -
+           * BuildCodeLengths для двух и более символов всегда строит полный код.
+           */
+            uint64_t available = 1; // Свободные коды текущей длины
+            uint64_t codeCount = 0;
+            for (int len = 1; len <= MAX_CODE_LENGTH; len++)
             {
-                break; // Достигнут конец файла
+                available <<= 1;
+                if (lengthCount[len] > available)
+                    throw runtime_error("Oversubscribed Huffman code lengths");
+                available -= lengthCount[len];
+                codeCount += lengthCount[len];
+
+                // Свободных кодов больше, чем символов: переполнения уже не будет, ограничиваем счетчик
+                if (available > static_cast<uint64_t>(symbolCount))
+                    available = static_cast<uint64_t>(symbolCount) + 1;
             }
+            if (available != 0 && codeCount > 1)
+                throw runtime_error("Incomplete Huffman code lengths");
 
-            // Получаем код Хаффмана для этого байта
-            vector<bool> huffmanCode = lookupTable[byte];
+            vector<uint64_t> codes(symbolCount);
+            MakeCanonicalCodes(lengths, symbolCount, codes.data());
 
-            // Записываем код в выходной поток
-            for (int i = 0; i < huffmanCode.size(); i++)
+            uint64_t code = 0;
+            int symbolIndex = 0;
+            for (int len = 1; len <= MAX_CODE_LENGTH; len++)
             {
-                writer.WriteBit(huffmanCode[i]);
-                compressedSize++; // Увеличиваем счетчик битов
+                code = (code + lengthCount[len - 1]) << 1;
+                firstCode[len] = code;
+                firstSymbol[len] = symbolIndex;
+                symbolIndex += static_cast<int>(lengthCount[len]);
+            }
+
+            sortedSymbols.assign(symbolIndex, 0);
+            array<int, MAX_CODE_LENGTH + 1> position = firstSymbol;
+            for (int i = 0; i < symbolCount; i++)
+            {
+                if (lengths[i] != 0)
+                    sortedSymbols[position[lengths[i]]++] = static_cast<uint16_t>(i);
+            }
+
+            // Первичная таблица не длиннее самого длинного кода (для маленьких файлов - маленькая таблица)
+            tableBits = (maxLength < LOOKUP_BITS) ? maxLength : LOOKUP_BITS;
+            if (tableBits < 1)
+                tableBits = 1;
+            table.assign(size_t(1) << tableBits, Entry{ 0, 0, 0 });
+
+            // Короткие коды: заполняем все элементы, индекс которых начинается с кода
+            for (int i = 0; i < symbolCount; i++)
+            {
+                int len = lengths[i];
+                if (len == 0 || len > tableBits)
+                    continue;
+
+                size_t first = static_cast<size_t>(codes[i]) << (tableBits - len);
+                size_t count = size_t(1) << (tableBits - len);
+                for (size_t j = 0; j < count; j++)
+                    table[first + j] = Entry{ static_cast<uint32_t>(i), static_cast<uint16_t>(len), 0 };
+            }
+
+            if (maxLength <= tableBits)
+                return;
+
+            // Длинные коды: для каждого префикса определяем разрядность его вторичной таблицы
+            vector<int> prefixMaxLength(size_t(1) << tableBits, 0);
+            for (int i = 0; i < symbolCount; i++)
+            {
+                int len = lengths[i];
+                if (len > tableBits)
+                {
+                    size_t prefix = static_cast<size_t>(codes[i] >> (len - tableBits));
+                    prefixMaxLength[prefix] = (len > prefixMaxLength[prefix]) ? len : prefixMaxLength[prefix];
+                }
+            }
+
+            for (size_t prefix = 0; prefix < prefixMaxLength.size(); prefix++)
+            {
+                int subBits = prefixMaxLength[prefix] - tableBits;
+                if (subBits <= 0)
+                    continue;
+
+                if (subBits > MAX_SUB_BITS)
+                {
+                    table[prefix] = Entry{ 0, 0, SLOW_PATH };
+                    continue;
+                }
+
+                table[prefix] = Entry{ static_cast<uint32_t>(table.size()), static_cast<uint16_t>(tableBits), static_cast<uint16_t>(subBits) };
+                table.resize(table.size() + (size_t(1) << subBits), Entry{ 0, 0, 0 });
+            }
+
+            // Заполняем вторичные таблицы окончаниями длинных кодов
+            for (int i = 0; i < symbolCount; i++)
+            {
+                int len = lengths[i];
+                if (len <= tableBits)
+                    continue;
+
+                Entry link = table[static_cast<size_t>(codes[i] >> (len - tableBits))];
+                if (link.subBits == SLOW_PATH)
+                    continue;
+
+                int rest = len - tableBits;
+                uint64_t suffix = codes[i] & ((uint64_t(1) << rest) - 1);
+                size_t first = link.value + (static_cast<size_t>(suffix) << (link.subBits - rest));
+                size_t count = size_t(1) << (link.subBits - rest);
+                for (size_t j = 0; j < count; j++)
+                    table[first + j] = Entry{ static_cast<uint32_t>(i), static_cast<uint16_t>(rest), 0 };
             }
-            dataSize++; // Увеличиваем счетчик исходных байтов
-            processedBytes.fetch_add(1);  // Обновляем прогресс
         }
 
-        // Записываем оставшиеся биты из буфера
-        writer.FlushFileBuffer();
+        // Декодирование одного символа: одна проба для коротких кодов, две - для длинных
+        // Reader - BitReader или MemoryBitReader (нужны PeekBits, Consume и ReadBit)
+        template <class Reader>
+        uint16_t Decode(Reader& reader)
+        {
+            Entry entry = table[reader.PeekBits(tableBits)];
 
-        // возвращаемся назад и пишем все метаданные 
-        streampos encodedDataEnd = out.tellp();
-        out.seekp(beg + 2, std::ios::beg);
+            if (entry.subBits != 0)
+            {
+                if (entry.subBits == SLOW_PATH)
+                    return DecodeSlow(reader);
 
-        out.write(reinterpret_cast<char*>(&dataSize), 8);
-        unsigned char padding = writer.GetPaddingBits();
-        out.write(reinterpret_cast<char*>(&padding), 1);
+                reader.Consume(tableBits);
+                entry = table[entry.value + reader.PeekBits(entry.subBits)];
+            }
 
-        out.seekp(encodedDataEnd);
+            if (entry.length == 0)
+                throw runtime_error("Invalid Huffman code");
 
-        return (compressedSize + static_cast<uint64_t>(padding))/8;
-    }
+            reader.Consume(entry.length);
+            return static_cast<uint16_t>(entry.value);
+        }
+    };
 
     /*
-    * Метод декодирования файла (распаковка)
-    * Формат входных данных:
-    * [Размер таблицы]  : 2 байта (uint16_t)
-    * [Размер данных]   : 8 байт (uint64_t)
-    * [Дополнение]      : 1 байт (uint8_t)
-    * [Таблица кодов]   : переменный размер
-    * [Закодированные данные] : битовый поток
+    * Метод кодирования файла (сжатие)
+    * Файл читается один раз: очередной блок буферизуется, по нему строится таблица кодов,
+    * затем блок кодируется и записывается (формат - в начале файла)
+    * Возвращает размер сжатых данных в байтах (вместе с заголовками блоков)
     */
-    void DecodeFile(ifstream& in, ofstream& out, atomic<uint64_t>& processedBytes)
+    uint64_t EncodeFile(ifstream& in, ofstream& out, atomic<uint64_t>& processedBytes)
     {
-        BitReader reader{ in };
-
-        // Шаг 1: Чтение метаданных
-        uint16_t tableSize = 0;
-        in.read(reinterpret_cast<char*>(&tableSize), 2);  // Размер таблицы
+        BitWriter writer{ out };
+        ByteHistogram byteFreq;
+        vector<unsigned char> block(blockSize);
+        uint64_t compressedSize = 0; // Размер сжатых данных в битах
 
-        uint64_t dataSize = 0;
-        in.read(reinterpret_cast<char*>(&dataSize), 8); // Размер исходных данных
+        while (true)
+        {
+            in.read(reinterpret_cast<char*>(block.data()), blockSize);
+            size_t size = static_cast<size_t>(in.gcount());
+            if (size == 0)
+                break; // Достигнут конец файла
 
-        unsigned char padding = 0;
-        in.read(reinterpret_cast<char*>(&padding), 1); // Биты дополнения
+            // Таблица кодов блока: частоты -> длины кодов (с ограничением) -> канонические коды
+            byteFreq.Reset();
+            byteFreq.Add(block.data(), size);
 
-        // Шаг 2: Построение дерева Хаффмана из таблицы кодов
-        shared_ptr<Node> root = make_shared<Node>(0, 0); // Создаем корень
+            codeLengths.fill(0);
+            codes.fill(0);
+            BuildCodeLengths(byteFreq.GetCounts().data(), 256, codeLengthLimit, codeLengths.data());
+            MakeCanonicalCodes(codeLengths.data(), 256, codes.data());
 
-        // читаем таблицу и строим дерево
-        for (int i = 0; i < tableSize; i++)
-        {
-            // Читаем символ и длину его кода
-            unsigned char encodedByte = reader.ReadByte();  // Символ
-            unsigned char codeLength = reader.ReadByte();  // Длина кода
+            uint16_t tableSize = 0; // Количество уникальных символов блока
+            for (int i = 0; i < 256; i++)
+            {
+                if (codeLengths[i] != 0)
+                    tableSize++;
+            }
 
-            // Начинаем с корня
-            shared_ptr<Node> current = root;
+            // Заголовок блока
+            writer.WriteBits(size, 32);
+            writer.WriteBits(tableSize, 16);
+            compressedSize += 48;
 
-            // Строим путь в дереве согласно коду
-            // Бит = 1 ->идем вправо
-            // Бит = 0 ->идем влево
-            for (int j = 0; j < codeLength; j++)
+            //Запись таблицы длин кодов
+            if (tableSize < SPARSE_TABLE_LIMIT)
             {
-                if (reader.ReadBit())
+                // Разреженная таблица: [Символ] (1 байт) + [Длина кода] (1 байт)
+                for (int i = 0; i < 256; i++)
                 {
-                    if (!current->right)
+                    if (codeLengths[i] != 0)
                     {
-                        current->right = make_shared<Node>(0, 0);
+                        writer.WriteByte(static_cast<unsigned char>(i)); //пишем сам байт
+                        writer.WriteByte(codeLengths[i]); //пишем длину присвоенного ему кода
                     }
-                    current = current->right;
                 }
-                else
+                compressedSize += 16 * tableSize;
+            }
+            else
+            {
+                // Полная таблица: длины кодов всех 256 символов по порядку
+                for (int i = 0; i < 256; i++)
                 {
-                    if (!current->left)
-                    {
-                        current->left = make_shared<Node>(0, 0);
-                    }
-                    current = current->left;
+                    writer.WriteByte(codeLengths[i]);
                 }
+                compressedSize += 8 * 256;
             }
-            // В конце пути записываем символ в листовой узел
-            current->byte = encodedByte;
+
+            // Кодирование данных блока
+            makePackedCodes();
+            compressedSize += encodeBlock(block.data(), size, writer);
+
+            // Выравниваем блок до границы байта
+            writer.FlushFileBuffer();
+            compressedSize += writer.GetPaddingBits();
+            writer.ResetPaddingBits();
+
+            processedBytes.fetch_add(size);  // Обновляем прогресс
         }
 
-        // Шаг 3: Декодирование данных
+        // Признак конца данных - блок нулевого размера
+        writer.WriteBits(0, 32);
+        writer.FlushFileBuffer();
+        compressedSize += 32;
+
+        return compressedSize / 8;
+    }
+
+    /*
+    * Метод декодирования файла (распаковка)
+    * Блоки декодируются по очереди, каждый со своей таблицей, до блока нулевого размера
+    */
+    void DecodeFile(ifstream& in, ofstream& out, atomic<uint64_t>& processedBytes)
+    {
+        BitReader reader{ in };
         BitWriter writer{ out };
+        DecodeTable decodeTable;
 
-        // Декодируем dataSize байтов
-        for (uint64_t i = 0; i < dataSize; i++)
+        while (true)
         {
-            shared_ptr<Node> current = root; // Начинаем с корня
+            // Шаг 1: Заголовок блока
+            uint32_t size = static_cast<uint32_t>(reader.ReadBits(32));
+            if (size == 0)
+                break; // Признак конца данных
+
+            uint16_t tableSize = static_cast<uint16_t>(reader.ReadBits(16));
 
-            // Читаем биты и движемся по дереву до листа
-            while (!current->isLeaf()) 
+            // Шаг 2: Чтение таблицы длин кодов
+            array<unsigned char, 256> lengths = { 0 };
+            if (tableSize < SPARSE_TABLE_LIMIT)
             {
-                bool bit = reader.ReadBit(); // Читаем очередной бит
-                if (bit)
+                // Разреженная таблица: пары [Символ] + [Длина кода]
+                for (int i = 0; i < tableSize; i++)
                 {
-                    current = current->right; // 1 -> вправо
+                    unsigned char encodedByte = reader.ReadByte();  // Символ
+                    lengths[encodedByte] = reader.ReadByte();  // Длина кода
                 }
-                else
+            }
+            else
+            {
+                // Полная таблица: длины кодов всех 256 символов
+                for (int i = 0; i < 256; i++)
                 {
-                    current = current->left; // 0 → влево
+                    lengths[i] = reader.ReadByte();
                 }
             }
 
-            // Достигли листа → записываем символ
-            writer.WriteByte(current->byte);
-            processedBytes++; // Обновляем прогресс
+            // Шаг 3: Построение таблиц декодирования прямо по длинам кодов
+            decodeTable.Build(lengths.data(), 256);
+
+            // Шаг 4: Декодирование size байтов блока
+            for (uint32_t i = 0; i < size; i++)
+            {
+                // Разрешаем код одной-двумя пробами таблицы и записываем символ
+                writer.WriteByte(static_cast<unsigned char>(decodeTable.Decode(reader)));
+            }
+            processedBytes.fetch_add(size); // Обновляем прогресс
+
+            // Шаг 5: Пропускаем дополнение до границы байта
+            reader.AlignToByte();
         }
 
-        // Шаг 4: Пропускаем биты дополнения (выравнивание до байта)
-        for (int i = 0; i < padding; i++)
-            reader.ReadBit();
+        // Возвращаем в архив байты, прочитанные читателем наперед
+        reader.SyncStream();
 
         // Записываем оставшиеся биты из буфера
         writer.FlushFileBuffer();